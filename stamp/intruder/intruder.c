@@ -100,6 +100,12 @@ enum param_defaults {
     PARAM_DEFAULT_SUPPORTED_THREAD = 1,
 };
 
+enum atomic_blocks {
+    AB_GETPACKET   = 1,
+    AB_PROCESS     = 2,
+    AB_GETCOMPLETE = 3,
+};
+
 long global_params[256] = { /* 256 = ascii limit */
     [PARAM_ATTACK] = PARAM_DEFAULT_ATTACK,
     [PARAM_LENGTH] = PARAM_DEFAULT_LENGTH,
@@ -201,7 +207,7 @@ processPackets (void* argPtr)
     while (1) {
 
         char* bytes;
-        TM_BEGIN();
+        TM_BEGIN_ID(AB_GETPACKET);
         bytes = TMSTREAM_GETPACKET(streamPtr);
         TM_END();
         if (!bytes) {
@@ -212,7 +218,7 @@ processPackets (void* argPtr)
         long flowId = packetPtr->flowId;
 
         error_t error;
-        TM_BEGIN();
+        TM_BEGIN_ID(AB_PROCESS);
         error = TMDECODER_PROCESS(decoderPtr,
                                   bytes,
                                   (PACKET_HEADER_LENGTH + packetPtr->length));
@@ -228,7 +234,7 @@ processPackets (void* argPtr)
 
         char* data;
         long decodedFlowId;
-        TM_BEGIN();
+        TM_BEGIN_ID(AB_GETCOMPLETE);
         data = TMDECODER_GETCOMPLETE(decoderPtr, &decodedFlowId);
         TM_END();
         if (data) {
@@ -113,6 +113,12 @@ long global_i; /* index into task queue */
 
 #define CHUNK 3
 
+enum atomic_blocks {
+    AB_CENTERS = 1,
+    AB_TASK    = 2,
+    AB_DELTA   = 3,
+};
+
 
 /* =============================================================================
  * work
@@ -165,7 +171,7 @@ work (void* argPtr)
             membership[i] = index;
 
             /* Update new cluster centers : sum of objects located within */
-            TM_BEGIN();
+            TM_BEGIN_ID(AB_CENTERS);
             TM_SHARED_WRITE(*new_centers_len[index],
                             TM_SHARED_READ(*new_centers_len[index]) + 1);
             for (j = 0; j < nfeatures; j++) {
@@ -179,7 +185,7 @@ work (void* argPtr)
 
         /* Update task queue */
         if (start + CHUNK < npoints) {
-            TM_BEGIN();
+            TM_BEGIN_ID(AB_TASK);
             start = (int)TM_SHARED_READ(global_i);
             TM_SHARED_WRITE(global_i, (start + CHUNK));
             TM_END();
@@ -188,7 +194,7 @@ work (void* argPtr)
         }
     }
 
-    TM_BEGIN();
+    TM_BEGIN_ID(AB_DELTA);
     TM_SHARED_WRITE_F(global_delta, TM_SHARED_READ_F(global_delta) + delta);
     TM_END();
 
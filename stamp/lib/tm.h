@@ -215,6 +215,11 @@
  * TM_BEGIN_RO()
  *     Begin atomic block / transaction that only reads shared data
  *
+ * TM_BEGIN_ID(id)
+ *     Begin atomic block / transaction with an identifier telling the
+ *     atomic block apart from the others (used by the TM to schedule
+ *     contended atomic blocks)
+ *
  * TM_END()
  *     End atomic block / transaction
  *
@@ -224,6 +229,10 @@
  * TM_EARLY_RELEASE()
  *     Remove speculatively read line from the read set
  *
+ * TM_POLL()
+ *     Abort the atomic block / transaction if it has been found invalid
+ *     (call periodically in long computations without shared accesses)
+ *
  * =============================================================================
  *
  * Example Usage:
@@ -310,18 +319,22 @@
 #    define thread_barrier_wait();      _Pragma ("omp barrier")
 #    define TM_BEGIN()                  _Pragma ("omp transaction") {
 #    define TM_BEGIN_RO()               _Pragma ("omp transaction") {
+#    define TM_BEGIN_ID(id)             _Pragma ("omp transaction") {
 #    define TM_END()                    }
 #    define TM_RESTART()                _TM_Abort()
 
 #    define TM_EARLY_RELEASE(var)       TM_Release(&(var))
+#    define TM_POLL()                   /* nothing */
 
 #  else /* !OTM */
 
 #    define TM_BEGIN()                    TM_BeginClosed()
 #    define TM_BEGIN_RO()                 TM_BeginClosed()
+#    define TM_BEGIN_ID(id)               TM_BeginClosed()
 #    define TM_END()                      TM_EndClosed()
 #    define TM_RESTART()                  _TM_Abort()
 #    define TM_EARLY_RELEASE(var)         TM_Release(&(var))
+#    define TM_POLL()                     /* nothing */
 
 #  endif /* !OTM */
 
@@ -424,7 +437,11 @@
                                           	  	  	  fprintf(stderr, "Error: unsupported long and pointer sizes\n"); \
                                           	  	  	  exit(1); \
                                         			 } \
-                                        			 stm_init(numThread, numSuppThreads); \
+                                        			 stm_init(); \
+                                        			 if (getenv("STM_SUPPORTERS_RATIO") == NULL) { \
+                                        				 int ratio = (numSuppThreads); \
+                                        				 stm_set_parameter("supporter_ratio", &ratio); \
+                                        			 } \
                                         			 mod_mem_init(0); \
                                         			 if (getenv("STM_STATS") != NULL) { \
                                         				 mod_stats_init(); \
@@ -457,24 +474,28 @@
 
 #    define TM_BEGIN()                  _Pragma ("omp transaction") {
 #    define TM_BEGIN_RO()               _Pragma ("omp transaction") {
+#    define TM_BEGIN_ID(id)             _Pragma ("omp transaction") {
 #    define TM_END()                    }
 #    define TM_RESTART()                omp_abort()
 
 #    define TM_EARLY_RELEASE(var)       /* nothing */
+#    define TM_POLL()                   /* nothing */
 
 #  else /* !OTM */
 
-#    define TM_START(ro)                do { \
-                                            stm_tx_attr_t _a = {0, ro}; \
+#    define TM_START(id, ro)            do { \
+                                            stm_tx_attr_t _a = {id, ro}; \
                                             sigjmp_buf *_e = stm_start(&_a); \
                                             if (_e != NULL) sigsetjmp(*_e, 0); \
                                         } while (0)
-#    define TM_BEGIN()                  TM_START(0)
-#    define TM_BEGIN_RO()               TM_START(1)
+#    define TM_BEGIN()                  TM_START(0, 0)
+#    define TM_BEGIN_RO()               TM_START(0, 1)
+#    define TM_BEGIN_ID(id)             TM_START(id, 0)
 #    define TM_END()                    stm_commit()
 #    define TM_RESTART()                stm_abort(0)
 
 #    define TM_EARLY_RELEASE(var)       /* nothing */
+#    define TM_POLL()                   stm_poll()
 
 #  endif /* !OTM */
 
@@ -520,10 +541,12 @@
 
 #  define TM_BEGIN()                    /* nothing */
 #  define TM_BEGIN_RO()                 /* nothing */
+#  define TM_BEGIN_ID(id)               /* nothing */
 #  define TM_END()                      /* nothing */
 #  define TM_RESTART()                  assert(0)
 
 #  define TM_EARLY_RELEASE(var)         /* nothing */
+#  define TM_POLL()                     /* nothing */
 
 #endif /* SEQUENTIAL */
 
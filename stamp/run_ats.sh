@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# Wasted work (total_tx_wasted_time, printed by stm_exit()) of kmeans and
+# intruder with adaptive transaction scheduling disabled (threshold 0)
+# and enabled (default threshold).  ATS is disabled by default: enable it
+# in tinySTM/Makefile (DEFINES += -DATS) and rebuild the library with
+# SUPPORTER_THREAD_TIMERS, then the benchmarks (make_all.sh).
+
+maxThread=8
+runPerThread=3
+thresholds="0 512"
+
+#------------------------------------------------------------------------------------------------
+#------------------------------------------------------------------------------------------------
+
+run() {
+	for threshold in $thresholds
+	do
+		k=0
+		while [ $k -lt $runPerThread ]
+		do
+			echo -n "$1 threads=$nthread threshold=$threshold "
+			STM_ATS_THRESHOLD=$threshold "$@" | tr '\t' '\n' | grep "wasted time" | sed -E -e "s/.*wasted time ([0-9.]*).*/wasted \1/"
+			k=$[$k+1]
+		done
+	done
+}
+
+nthread=2
+while [ $nthread -le $maxThread ]
+do
+	run ./kmeans/kmeans -m15 -n15 -t0.00001 -i kmeans/inputs/random-n2048-d16-c16.txt -p$nthread -z1
+	run ./intruder/intruder -a10 -l16 -n4096 -s1 -t$nthread -z1
+	nthread=$[$nthread*2]
+done
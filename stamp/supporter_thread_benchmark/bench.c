@@ -39,6 +39,8 @@ void spend_some_time(){
 	while(cycles<dummy_cycles) {	
 		dummy_sum+=random_number(&pseed);
 	 	cycles++;
+		//stop early if the supporter found the transaction invalid
+		if ((cycles & 63) == 0) TM_POLL();
 	}
 }
 
@@ -64,6 +64,7 @@ extern void _ITM_CALL_CONVENTION _ITM_siglongjmp(sigjmp_buf env, int val) __attr
 #include "mod_cb.c"
 #include "mod_stats.c"
 #include "wrappers.c"
+#include "topology.c"
 #ifdef EPOCH_GC
 #include "gc.c"
 #endif
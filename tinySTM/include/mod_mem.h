@@ -104,7 +104,8 @@ void stm_free2(TXPARAMS void *addr, size_t idx, size_t size);
  *
  * @param gc
  *   True (non-zero) to enable epoch-based garbage collector when
- *   freeing memory in transactions.
+ *   freeing memory in transactions.  The garbage collector is always
+ *   used when the library is compiled with MULTI_VERSION.
  */
 void mod_mem_init(int gc);
 
@@ -237,6 +237,38 @@ enum {
   STM_ABORT_OTHER = (1 << 5) | (0x0F << 8)
 };
 
+/**
+ * Decisions of a contention manager (CM_MODULAR only).  A custom
+ * contention manager is set with the "cm_function" parameter, as a
+ * function int f(struct stm_tx *tx, struct stm_tx *owner, int reason)
+ * called when transaction tx finds a memory location locked by
+ * transaction owner (NULL if unknown), upon a read (reason
+ * STM_ABORT_RW_CONFLICT) or upon a write or commit
+ * (STM_ABORT_WW_CONFLICT).  It returns a combination of these flags.
+ */
+enum {
+  /**
+   * Abort tx.
+   */
+  STM_CM_ABORT = 0,
+  /**
+   * Wait for the location to be unlocked, then retry the access.  The
+   * wait is bounded when the owner may be waiting for tx, after which
+   * tx aborts.
+   */
+  STM_CM_WAIT = (1 << 0),
+  /**
+   * If tx aborts, wait for the location to be unlocked before
+   * restarting.
+   */
+  STM_CM_DELAY = (1 << 1),
+  /**
+   * If tx aborts, wait for a random delay before restarting (the range
+   * doubles with every consecutive abort).
+   */
+  STM_CM_BACKOFF = (1 << 2)
+};
+
 
 #ifdef SUPPORTER_THREAD
 
@@ -249,6 +281,9 @@ enum {
 
 typedef unsigned long long stm_time_t;
 
+/* Buckets of the latency histograms (see stm_get_supporter_stats()) */
+#define STM_LATENCY_BUCKETS 32
+
 #endif /* SUPPORTER_THREAD */
 
 /* ################################################################### *
@@ -259,12 +294,27 @@ typedef unsigned long long stm_time_t;
  * Initialize the STM library.  This function must be called once, from
  * the main thread, before any access to the other functions of the
  * library.
+ *
+ * Supporter threads are configured with the "supporter_ratio" (number
+ * of workers per group of supporters, 0 to disable them),
+ * "supporter_cpus" (maximum number of supporters running at once, 0 for
+ * no limit) and "supporter_policy" ("fixed" or "adaptive" pool size)
+ * parameters, which can be set before or after stm_init() (the ratio
+ * only while no thread is registered).  stm_init() reads the
+ * STM_SUPPORTERS_RATIO, STM_SUPPORTERS_CPUS, STM_SUPPORTERS_POLICY,
+ * STM_SUPPORTERS_PLACEMENT, STM_SUPPORTERS_WAIT,
+ * STM_SUPPORTERS_SPIN_BUDGET and STM_SUPPORTERS_SCHEDULE environment
+ * variables, which override the corresponding parameters, as well as
+ * STM_LOCK_WAIT and STM_LOCK_SPIN_BUDGET ("lock_wait_policy" and
+ * "lock_spin_budget": how transactions wait on locked stripes) and
+ * STM_ATS_THRESHOLD ("ats_threshold": contention intensity, from 0 to
+ * 1024, above which the instances of an atomic block run one at a time,
+ * 0 to never serialize them; atomic blocks are told apart by the id of
+ * their attributes, and transactions without an id are never
+ * serialized; needs ATS).  The supporters of a group are started when its
+ * first worker calls stm_init_thread().
  */
-#ifdef SUPPORTER_THREAD
-void stm_init(int supp_threads, int numSuppThreads);
-#else /* ! SUPPORTER_THREAD */
 void stm_init();
-#endif
 
 /**
  * Clean up the STM library.  This function must be called once, from
@@ -368,6 +418,119 @@ void stm_store(TXPARAMS volatile stm_word_t *addr, stm_word_t value);
  */
 void stm_store2(TXPARAMS volatile stm_word_t *addr, stm_word_t value, stm_word_t mask);
 
+/**
+ * Check if the current transaction has been found invalid by its
+ * supporter thread and, if so, abort it (execution continues at the
+ * point where sigsetjmp() has been called).  Loads, stores and
+ * allocations poll implicitly; long computations that do not access
+ * shared memory should call this function periodically so that a
+ * doomed transaction stops wasting CPU time.  Does nothing outside of
+ * a transaction.
+ */
+void stm_poll(TXPARAM);
+
+/**
+ * Allow (or forbid) the supporter thread to abort the current
+ * transaction asynchronously, by sending a signal to the thread, as
+ * soon as it finds the transaction invalid.  This is only effective if
+ * the library has been compiled with SUPPORTER_DOOM_SIGNAL.  While
+ * enabled, the code executed by the transaction can be interrupted at
+ * any point: it must not access shared memory through the STM, nor
+ * call functions that are not async-signal-safe (e.g., malloc).  The
+ * setting is reset when the transaction commits or restarts.
+ *
+ * @param enable
+ *   True (non-zero) to allow asynchronous aborts, false (zero) to
+ *   forbid them.
+ * @return
+ *   The previous setting.
+ */
+int stm_async_abort(TXPARAMS int enable);
+
+#ifdef SUPPORTER_THREAD
+/**
+ * Start the supporter threads.  The supporters of a group are started
+ * when its first worker calls stm_init_thread(), hence this function is
+ * only needed after a call to stm_supporters_stop(): it restarts the
+ * supporters of the existing groups, and those of the groups created
+ * later start with their first worker again.  Does nothing if the
+ * supporters are already running.
+ */
+void stm_supporters_start(void);
+
+/**
+ * Stop the supporter threads and wait until they have terminated.
+ * Transactions keep running without supporters (they validate by
+ * themselves) until stm_supporters_start() is called.  Does nothing if
+ * the supporters are not running.  stm_exit() stops the supporters
+ * implicitly.
+ */
+void stm_supporters_stop(void);
+
+/**
+ * Suspend the supporter threads, e.g., during a sequential phase of the
+ * application.  The function returns once no supporter accesses the
+ * transaction descriptors, the locks or the clock any more; the
+ * supporters remain blocked until the matching call to
+ * stm_supporters_resume().  Calls can be nested.
+ */
+void stm_supporters_pause(void);
+
+/**
+ * Resume the supporter threads after stm_supporters_pause().
+ */
+void stm_supporters_resume(void);
+
+/**
+ * Get aggregate statistics about the supporter threads and the workers
+ * they help, including the threads still running (whose counters are
+ * then read without synchronization).  Supported statistics (unsigned
+ * long): "supporter_passes", "supporter_stale_passes" (passes that
+ * ended after a newer commit), "supporter_validations",
+ * "supporter_entries" (read set entries validated),
+ * "supporter_dooms", "supporter_extensions" (extensions taken from a
+ * verdict at load time) and "supporter_self_extensions" (extensions
+ * validated by the workers themselves).  "supporter_doom_latency" fills
+ * an array of STM_LATENCY_BUCKETS unsigned long: bucket b counts the
+ * aborts that happened between 2^b and 2^(b+1) timer ticks after the
+ * doom verdict.  "lock_waits", "lock_wait_aborts" and
+ * "lock_wait_parks" count the waits of the workers on locked stripes,
+ * those that gave up and aborted, and the sleeps on a lock owner;
+ * "lock_wait_latency" is the histogram of the wait times, with the same
+ * buckets.  "ats_queued" counts the transactions that waited for their
+ * turn behind other instances of their atomic block.  With
+ * MULTI_VERSION, "mv_reads" counts the old versions read by read-only
+ * snapshots, "mv_misses" the snapshots restarted because a version was
+ * no longer kept and "mv_kept" the versions kept by update commits.
+ * With GROUP_COMMIT, "group_batches" counts the batches of commits
+ * combined by a thread and "group_commits" the commits written back in
+ * these batches.
+ * The same statistics are available for the current thread through
+ * stm_get_stats().
+ *
+ * @param name
+ *   Name of the statistics.
+ * @param val
+ *   Pointer to the variable that should hold the value of the
+ *   statistics.
+ * @return
+ *   1 upon success, 0 otherwise.
+ */
+int stm_get_supporter_stats(const char *name, void *val);
+
+/**
+ * Dump the statistics of the supporters and of the running workers to a
+ * stream, as lines made of a key and one or more values (e.g.,
+ * "worker.3.dooms 12" or "supporter.0.1.passes 4000").  The key set is
+ * stable.  stm_exit() writes the dump to the file named by the
+ * STM_STATS_DUMP environment variable ("-" for the standard output).
+ *
+ * @param f
+ *   Stream to write to.
+ */
+void stm_dump_stats(FILE *f);
+#endif /* SUPPORTER_THREAD */
+
 /**
  * Check if the current transaction is still active.
  *
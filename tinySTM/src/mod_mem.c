@@ -70,6 +70,9 @@ void *stm_malloc(TXPARAMS size_t size)
   mi = (mod_mem_info_t *)stm_get_specific(TXARGS mod_mem_key);
   assert(mi != NULL);
 
+  /* Do not allocate on behalf of a doomed transaction */
+  stm_poll(TXARG);
+
   /* ASF can abort anywhere => libc malloc is not safe for this */
 #ifdef HYDRID_ASF
   if (stm_hybrid()) {
@@ -116,6 +119,9 @@ void *stm_calloc(TXPARAMS size_t nm, size_t size)
   mi = (mod_mem_info_t *)stm_get_specific(TXARGS mod_mem_key);
   assert(mi != NULL);
 
+  /* Do not allocate on behalf of a doomed transaction */
+  stm_poll(TXARG);
+
   /* ASF can abort anywhere => libc malloc is not safe for this */
 #ifdef HYDRID_ASF
   if (stm_hybrid()) {
@@ -171,6 +177,9 @@ void stm_free2(TXPARAMS void *addr, size_t idx, size_t size)
   mi = (mod_mem_info_t *)stm_get_specific(TXARGS mod_mem_key);
   assert(mi != NULL);
 
+  /* Do not schedule frees on behalf of a doomed transaction */
+  stm_poll(TXARG);
+
   /* ASF can abort anywhere => libc malloc is not safe for this */
 #ifdef HYDRID_ASF
   if (stm_hybrid()) {
@@ -328,7 +337,12 @@ void mod_mem_init(int gc)
     exit(1);
   }
 #ifdef EPOCH_GC
+# ifdef MULTI_VERSION
+  /* Snapshot transactions may dereference memory freed after they started */
+  mod_mem_use_gc = 1;
+# else /* ! MULTI_VERSION */
   mod_mem_use_gc = gc;
+# endif /* ! MULTI_VERSION */
 #endif /* EPOCH_GC */
   mod_mem_initialized = 1;
 }
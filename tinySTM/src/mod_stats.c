@@ -74,6 +74,10 @@ int stm_get_global_stats(const char *name, void *val)
     *(unsigned long *)val = mod_stats_global.retries_max;
     return 1;
   }
+#ifdef SUPPORTER_THREAD
+  if (strncmp("supporter_", name, 10) == 0)
+    return stm_get_supporter_stats(name, val);
+#endif /* SUPPORTER_THREAD */
 
   return 0;
 }
@@ -113,6 +117,10 @@ int stm_get_local_stats(TXPARAMS const char *name, void *val)
     *(unsigned long *)val = stats->retries_max;
     return 1;
   }
+#ifdef SUPPORTER_THREAD
+  if (strncmp("supporter_", name, 10) == 0)
+    return stm_get_stats(TXARGS name, val);
+#endif /* SUPPORTER_THREAD */
 
   return 0;
 }
@@ -24,15 +24,38 @@
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 
 #include <pthread.h>
 #include <sched.h>
+#include <time.h>
+#ifdef __linux__
+# include <limits.h>
+# include <unistd.h>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif /* __linux__ */
 
 #include "stm.h"
 
 #include "atomic.h"
 #include "gc.h"
+#include "topology.h"
+#include "verdict.h"
+
+#ifdef SIMD_VALIDATION
+# if defined(__x86_64__) && defined(__GNUC__)
+#  include <immintrin.h>
+# else /* ! (__x86_64__ && __GNUC__) */
+#  undef SIMD_VALIDATION
+# endif /* ! (__x86_64__ && __GNUC__) */
+#endif /* SIMD_VALIDATION */
+
+#if defined(READ_SET_INDEX) && ! defined(NO_DUPLICATES_IN_RW_SETS)
+/* The read set is only looked up upon reads to avoid duplicates */
+# undef READ_SET_INDEX
+#endif /* defined(READ_SET_INDEX) && ! defined(NO_DUPLICATES_IN_RW_SETS) */
 
 #ifdef HYBRID_ASF
 # include "asf/asf-highlevel.h"
@@ -75,7 +98,9 @@ static const char *design_names[] = {
   /* 2 */ "WRITE-THROUGH"
 };
 
+#ifndef DESIGN
 # define DESIGN                         WRITE_BACK_CTL
+#endif /* ! DESIGN */
 
 /* Contention managers */
 #define CM_SUICIDE                      0
@@ -94,18 +119,56 @@ static const char *cm_names[] = {
 # define CM                             CM_SUICIDE
 #endif /* ! CM */
 
-#if DESIGN != WRITE_BACK_ETL && CM == CM_MODULAR
-# error "MODULAR contention manager can only be used with WB-ETL design"
-#endif /* DESIGN != WRITE_BACK_ETL && CM == CM_MODULAR */
+/* Policies of the modular contention manager */
+#define CM_POLICY_SUICIDE               0                   /* Abort upon conflict */
+#define CM_POLICY_DELAY                 1                   /* Abort, restart once the lock is released */
+#define CM_POLICY_BACKOFF               2                   /* Abort, restart after a random delay */
+#define CM_POLICY_WAIT                  3                   /* Wait for the owner of the lock */
+#define CM_POLICY_TIMESTAMP             4                   /* Older transactions wait, younger ones abort */
+#define CM_POLICY_KARMA                 5                   /* Transactions that did more work wait, others abort */
+#define CM_POLICY_SUPPORTER             6                   /* Delay, back off while dooms hit the same stripe */
+#define CM_POLICY_CUSTOM                7                   /* Function set with the "cm_function" parameter */
+
+#if CM == CM_MODULAR
+static const char *cm_policy_names[] = {
+  /* 0 */ "suicide",
+  /* 1 */ "delay",
+  /* 2 */ "backoff",
+  /* 3 */ "wait",
+  /* 4 */ "timestamp",
+  /* 5 */ "karma",
+  /* 6 */ "supporter",
+  /* 7 */ "custom"
+};
+#endif /* CM == CM_MODULAR */
+
+#ifndef CM_POLICY
+# define CM_POLICY                      CM_POLICY_WAIT
+#endif /* ! CM_POLICY */
+
+/* Global clock schemes */
+#define CLOCK_GV1                       0
+#define CLOCK_GV4                       1
+#define CLOCK_GV5                       2
+#define CLOCK_GV6                       3
+#define CLOCK_NODE                      4
+
+static const char *clock_names[] = {
+  /* 0 */ "GV1",
+  /* 1 */ "GV4",
+  /* 2 */ "GV5",
+  /* 3 */ "GV6",
+  /* 4 */ "NODE"
+};
+
+#ifndef CLOCK_SCHEME
+# define CLOCK_SCHEME                   CLOCK_GV1
+#endif /* ! CLOCK_SCHEME */
 
 #if defined(CONFLICT_TRACKING) && ! defined(EPOCH_GC)
 # error "CONFLICT_TRACKING requires EPOCH_GC"
 #endif /* defined(CONFLICT_TRACKING) && ! defined(EPOCH_GC) */
 
-#if CM == CM_MODULAR && ! defined(EPOCH_GC)
-# error "MODULAR contention manager requires EPOCH_GC"
-#endif /* CM == CM_MODULAR && ! defined(EPOCH_GC) */
-
 #if defined(READ_LOCKED_DATA) && CM != CM_MODULAR
 # error "READ_LOCKED_DATA can only be used with MODULAR contention manager"
 #endif /* defined(READ_LOCKED_DATA) && CM != CM_MODULAR */
@@ -114,6 +177,29 @@ static const char *cm_names[] = {
 # error "SIGNAL_HANDLER can only be used without EPOCH_GC"
 #endif /* defined(EPOCH_GC) && defined(SIGNAL_HANDLER) */
 
+#if defined(MULTI_VERSION) && ! defined(EPOCH_GC)
+# error "MULTI_VERSION requires EPOCH_GC"
+#endif /* defined(MULTI_VERSION) && ! defined(EPOCH_GC) */
+
+#if defined(GROUP_COMMIT) && CLOCK_SCHEME != CLOCK_GV1
+# error "GROUP_COMMIT requires CLOCK_SCHEME == CLOCK_GV1"
+#endif /* defined(GROUP_COMMIT) && CLOCK_SCHEME != CLOCK_GV1 */
+
+#if DESIGN != WRITE_BACK_CTL
+/* Only commit-time locking looks up the write set upon reads and writes
+ * (encounter-time locking finds it through the lock) */
+# undef USE_BLOOM_FILTER
+# undef WRITE_SET_INDEX
+#endif /* DESIGN != WRITE_BACK_CTL */
+
+#if (defined(USE_BLOOM_FILTER) || defined(WRITE_SET_INDEX)) && __SIZEOF_POINTER__ < 8
+# error "USE_BLOOM_FILTER and WRITE_SET_INDEX require 64-bit words (see SET_HASH)"
+#endif /* (defined(USE_BLOOM_FILTER) || defined(WRITE_SET_INDEX)) && __SIZEOF_POINTER__ < 8 */
+
+#if defined(READ_SET_INDEX) && __SIZEOF_POINTER__ < 8
+# error "READ_SET_INDEX requires 64-bit words (see SET_HASH)"
+#endif /* defined(READ_SET_INDEX) && __SIZEOF_POINTER__ < 8 */
+
 #if defined(HYBRID_ASF) && CM != CM_SUICIDE
 # error "HYBRID_ASF can only be used with SUICIDE contention manager"
 #endif /* defined(HYBRID_ASF) && CM != CM_SUICIDE */
@@ -151,6 +237,18 @@ static const char *cm_names[] = {
 # define RW_SET_SIZE                    4096                /* Initial size of read/write sets */
 #endif /* ! RW_SET_SIZE */
 
+#ifndef BLOOM_FILTER_WORDS
+# define BLOOM_FILTER_WORDS             8                   /* Size of the write set Bloom filter (words) */
+#endif /* ! BLOOM_FILTER_WORDS */
+
+#ifndef WRITE_SET_INDEX_THRESHOLD
+# define WRITE_SET_INDEX_THRESHOLD      16                  /* Write set entries before using the index */
+#endif /* ! WRITE_SET_INDEX_THRESHOLD */
+
+#ifndef READ_SET_INDEX_THRESHOLD
+# define READ_SET_INDEX_THRESHOLD       16                  /* Read set entries before using the index */
+#endif /* ! READ_SET_INDEX_THRESHOLD */
+
 #ifndef LOCK_ARRAY_LOG_SIZE
 # define LOCK_ARRAY_LOG_SIZE            20                  /* Size of lock array: 2^20 = 1M */
 #endif /* LOCK_ARRAY_LOG_SIZE */
@@ -159,14 +257,164 @@ static const char *cm_names[] = {
 # define LOCK_SHIFT_EXTRA               2                   /* 2 extra shift */
 #endif /* LOCK_SHIFT_EXTRA */
 
-#if CM == CM_BACKOFF
+#if CM == CM_BACKOFF || CM == CM_MODULAR
 # ifndef MIN_BACKOFF
 #  define MIN_BACKOFF                   (1UL << 2)
 # endif /* MIN_BACKOFF */
 # ifndef MAX_BACKOFF
-#  define MAX_BACKOFF                   (1UL << 31)
+#  define MAX_BACKOFF                   (1UL << 16)
 # endif /* MAX_BACKOFF */
-#endif /* CM == CM_BACKOFF */
+#endif /* CM == CM_BACKOFF || CM == CM_MODULAR */
+
+#ifndef SUPPORTER_RATIO
+# define SUPPORTER_RATIO                0                   /* Workers per group of supporters (0 = no supporters) */
+#endif /* ! SUPPORTER_RATIO */
+#ifndef SUPPORTER_CPUS
+# define SUPPORTER_CPUS                 0                   /* Maximum supporters running at once (0 = no limit) */
+#endif /* ! SUPPORTER_CPUS */
+#ifndef SUPPORTER_POOL
+# define SUPPORTER_POOL                 SUPPORTER_POOL_ADAPTIVE /* How the size of the pools evolves */
+#endif /* ! SUPPORTER_POOL */
+#ifndef SUPPORTER_PLACEMENT
+# define SUPPORTER_PLACEMENT            TOPO_PLACE_SMT      /* Supporter on SMT sibling of its first worker */
+#endif /* ! SUPPORTER_PLACEMENT */
+#ifndef SUPPORTER_MAX_PER_GROUP
+# define SUPPORTER_MAX_PER_GROUP        2                   /* Maximum supporters per group of workers */
+#endif /* ! SUPPORTER_MAX_PER_GROUP */
+#ifndef SUPPORTER_MIN_PER_GROUP
+# define SUPPORTER_MIN_PER_GROUP        0                   /* Minimum supporters per group of workers */
+#endif /* ! SUPPORTER_MIN_PER_GROUP */
+#ifndef SUPPORTER_INITIAL_PER_GROUP
+# define SUPPORTER_INITIAL_PER_GROUP    1                   /* Supporters started with each group (by its first worker) */
+#endif /* ! SUPPORTER_INITIAL_PER_GROUP */
+#ifndef SUPPORTER_SUPERVISOR_PERIOD
+# define SUPPORTER_SUPERVISOR_PERIOD    10000               /* Sampling period in microseconds (0 = fixed pool) */
+#endif /* ! SUPPORTER_SUPERVISOR_PERIOD */
+#ifndef SUPPORTER_GROW_ABORT_RATE
+# define SUPPORTER_GROW_ABORT_RATE      20                  /* Abort rate (%) above which supporters are added */
+#endif /* ! SUPPORTER_GROW_ABORT_RATE */
+#ifndef SUPPORTER_SHRINK_ABORT_RATE
+# define SUPPORTER_SHRINK_ABORT_RATE    2                   /* Abort rate (%) below which supporters are removed */
+#endif /* ! SUPPORTER_SHRINK_ABORT_RATE */
+#ifndef SUPPORTER_SHRINK_HELP_RATE
+# define SUPPORTER_SHRINK_HELP_RATE     5                   /* ... provided they help fewer transactions (%) */
+#endif /* ! SUPPORTER_SHRINK_HELP_RATE */
+#ifndef SUPPORTER_SHRINK_PERIODS
+# define SUPPORTER_SHRINK_PERIODS       5                   /* ... during that many consecutive periods */
+#endif /* ! SUPPORTER_SHRINK_PERIODS */
+#ifndef SUPPORTER_RETIRE_DELAY
+# define SUPPORTER_RETIRE_DELAY         1000                /* Parked time in milliseconds before retiring */
+#endif /* ! SUPPORTER_RETIRE_DELAY */
+#ifndef SUPPORTER_WAIT
+# define SUPPORTER_WAIT                 SUPPORTER_WAIT_PARK /* How supporters wait for commits */
+#endif /* ! SUPPORTER_WAIT */
+#ifndef SUPPORTER_SCHEDULE
+# define SUPPORTER_SCHEDULE             SUPPORTER_SCHED_RR  /* Order in which supporters validate transactions */
+#endif /* ! SUPPORTER_SCHEDULE */
+#ifndef SUPPORTER_SPIN_BUDGET
+# define SUPPORTER_SPIN_BUDGET          1024                /* Pause iterations before yielding or parking */
+#endif /* ! SUPPORTER_SPIN_BUDGET */
+#ifndef SUPPORTER_PARK_TIMEOUT
+# define SUPPORTER_PARK_TIMEOUT         10000               /* Maximum time parked on a commit, in microseconds */
+#endif /* ! SUPPORTER_PARK_TIMEOUT */
+#ifndef LOCK_WAIT
+# define LOCK_WAIT                      LOCK_WAIT_OWNER     /* How transactions wait on locked stripes */
+#endif /* ! LOCK_WAIT */
+#ifndef LOCK_SPIN_BUDGET
+# define LOCK_SPIN_BUDGET               1024                /* Pause iterations on a locked stripe before yielding */
+#endif /* ! LOCK_SPIN_BUDGET */
+#ifndef LOCK_YIELD_BUDGET
+# define LOCK_YIELD_BUDGET              16                  /* Yields before aborting or sleeping on the owner */
+#endif /* ! LOCK_YIELD_BUDGET */
+#ifndef LOCK_PARK_TIMEOUT
+# define LOCK_PARK_TIMEOUT              1000                /* Maximum time asleep on a lock owner, in microseconds */
+#endif /* ! LOCK_PARK_TIMEOUT */
+#ifdef ATS
+# ifndef ATS_BLOCKS
+#  define ATS_BLOCKS                    64                  /* Atomic blocks tracked (identifiers are hashed) */
+# endif /* ! ATS_BLOCKS */
+# ifndef ATS_THRESHOLD
+#  define ATS_THRESHOLD                 512                 /* Contention intensity above which a block is serialized (0 = never) */
+# endif /* ! ATS_THRESHOLD */
+# ifndef ATS_DECAY
+#  define ATS_DECAY                     3                   /* Each outcome weighs 1/2^ATS_DECAY in the intensity */
+# endif /* ! ATS_DECAY */
+# define ATS_ONE                        1024                /* Intensity of a block whose transactions always abort */
+#endif /* ATS */
+#ifdef MULTI_VERSION
+# ifndef MV_VERSIONS
+#  define MV_VERSIONS                   8                   /* Old versions kept per stripe */
+# endif /* ! MV_VERSIONS */
+#endif /* MULTI_VERSION */
+#define SUPPORTER_CACHELINE             64                  /* Cache line size (for isolation) */
+#define SUPPORTER_LATENCY_BUCKETS       STM_LATENCY_BUCKETS /* Latency histograms: bucket b counts [2^b, 2^(b+1)) ticks */
+
+/* Verdicts of the supporters: see verdict.h */
+
+#ifdef SUPPORTER_WORK_STEALING
+# ifndef SUPPORTER_DEQUE_SIZE
+#  define SUPPORTER_DEQUE_SIZE          64                  /* Validation tasks queued per supporter (power of 2) */
+# endif /* ! SUPPORTER_DEQUE_SIZE */
+#endif /* SUPPORTER_WORK_STEALING */
+
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+# ifndef SUPPORTER_CHUNK_THRESHOLD
+#  define SUPPORTER_CHUNK_THRESHOLD     8192                /* Read set size validated by several supporters */
+# endif /* ! SUPPORTER_CHUNK_THRESHOLD */
+# ifndef SUPPORTER_CHUNK_SIZE
+#  define SUPPORTER_CHUNK_SIZE          1024                /* Read set entries per chunk (multiple of a cache line) */
+# endif /* ! SUPPORTER_CHUNK_SIZE */
+# define SUPPORTER_CHUNK_BITS           32                  /* Chunk index bits in the job counter */
+# define SUPPORTER_CHUNK_MASK           (((stm_word_t)1 << SUPPORTER_CHUNK_BITS) - 1)
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+
+#ifdef SUPPORTER_COMMIT_LOG
+# if DESIGN != WRITE_BACK_CTL
+#  error "SUPPORTER_COMMIT_LOG requires DESIGN == WRITE_BACK_CTL"
+# endif /* DESIGN != WRITE_BACK_CTL */
+# if CLOCK_SCHEME != CLOCK_GV1
+#  error "SUPPORTER_COMMIT_LOG requires CLOCK_SCHEME == CLOCK_GV1"
+# endif /* CLOCK_SCHEME != CLOCK_GV1 */
+# ifndef COMMIT_LOG_SIZE
+#  define COMMIT_LOG_SIZE               1024                /* Released locks remembered per committer (power of 2) */
+# endif /* ! COMMIT_LOG_SIZE */
+# ifndef COMMIT_LOG_INDEX_SIZE
+#  define COMMIT_LOG_INDEX_SIZE         4096                /* Last timestamps mapped to their committer (power of 2) */
+# endif /* ! COMMIT_LOG_INDEX_SIZE */
+# define COMMIT_LOG_BUSY                (~(stm_word_t)0)    /* Index record being written */
+# define COMMIT_LOG_NONE                0xFFFF              /* Slot of a timestamp that released no lock */
+# define COMMIT_LOG_INFO(pos, slot)     ((stm_word_t)(pos) << 16 | (stm_word_t)(slot))
+# define COMMIT_LOG_POS(info)           ((info) >> 16)
+# define COMMIT_LOG_SLOT(info)          ((int)((info) & 0xFFFF))
+# ifndef READ_SIG_BITS
+#  define READ_SIG_BITS                 1024                /* Size of the read signature (power of 2) */
+# endif /* ! READ_SIG_BITS */
+# define READ_SIG_WORDS                 (READ_SIG_BITS / (sizeof(stm_word_t) * 8))
+# define READ_SIG_WORD(i)               (((i) & (READ_SIG_BITS - 1)) / (sizeof(stm_word_t) * 8))
+# define READ_SIG_MASK(i)               ((stm_word_t)1 << ((i) & (sizeof(stm_word_t) * 8 - 1)))
+#endif /* SUPPORTER_COMMIT_LOG */
+
+#ifdef SUPPORTER_PREACQUIRE
+# if DESIGN != WRITE_BACK_CTL
+#  error "SUPPORTER_PREACQUIRE requires DESIGN == WRITE_BACK_CTL"
+# endif /* DESIGN != WRITE_BACK_CTL */
+# ifndef SUPPORTER_PREACQUIRE_THRESHOLD
+#  define SUPPORTER_PREACQUIRE_THRESHOLD 64                 /* Write set entries above which commit locks are shared */
+# endif /* ! SUPPORTER_PREACQUIRE_THRESHOLD */
+# ifndef SUPPORTER_PREACQUIRE_CHUNK
+#  define SUPPORTER_PREACQUIRE_CHUNK    16                  /* Write set entries locked per claim */
+# endif /* ! SUPPORTER_PREACQUIRE_CHUNK */
+# define SUPPORTER_ACQ_BITS             32                  /* Chunk index bits in the claim counter */
+# define SUPPORTER_ACQ_MASK             (((stm_word_t)1 << SUPPORTER_ACQ_BITS) - 1)
+#endif /* SUPPORTER_PREACQUIRE */
+
+#ifdef SUPPORTER_DOOM_SIGNAL
+# ifndef SUPPORTER_DOOM_SIGNO
+#  define SUPPORTER_DOOM_SIGNO          SIGUSR1             /* Signal sent to doomed transactions */
+# endif /* ! SUPPORTER_DOOM_SIGNO */
+#endif /* SUPPORTER_DOOM_SIGNAL */
+
+#define VALIDATE_BLOCK                  256                 /* Entries validated between checks for early exit */
 
 #define NO_SIGNAL_HANDLER               "NO_SIGNAL_HANDLER"
 
@@ -196,6 +444,31 @@ enum {                                  /* Transaction status */
 
 #define IS_ACTIVE(s)                    ((GET_STATUS(s) & 0x01) == TX_ACTIVE) 
 
+#if defined(READ_SET_INDEX) || defined(WRITE_SET_INDEX)
+typedef struct set_index {              /* Index of a read or write set */
+  stm_word_t *slots;                    /* Open addressing table: generation << 32 | entry + 1 */
+  int bits;                             /* Log2 of the size of the table */
+  int nb_indexed;                       /* Entries in the table (0 below the threshold) */
+  stm_word_t gen;                       /* Generation of the valid slots (one per attempt) */
+} set_index_t;
+#endif /* defined(READ_SET_INDEX) || defined(WRITE_SET_INDEX) */
+
+#ifdef RW_SET_SOA
+typedef struct r_set {                  /* Read set (struct of arrays) */
+  uint32_t *idx;                        /* Indices of the locks */
+  uint32_t *versions;                   /* Versions read (VERSION_MAX fits on 32 bits) */
+  volatile int nb_entries;              /* Number of entries */
+  int size;                             /* Size of arrays */
+# ifdef READ_SET_INDEX
+  set_index_t index;                    /* Index of the locks read */
+# endif /* READ_SET_INDEX */
+} r_set_t;
+
+# define RS_LOCK(rs, i)                 (&locks[(rs)->idx[i]])
+# define RS_VERSION(rs, i)              ((stm_word_t)(rs)->versions[i])
+# define RS_SET(rs, i, l, v)            ((rs)->idx[i] = (uint32_t)((l) - locks), (rs)->versions[i] = (uint32_t)(v))
+# define RS_BASE(rs)                    ((rs)->idx)
+#else /* ! RW_SET_SOA */
 typedef struct r_entry {                /* Read set entry */
   volatile stm_word_t version;                   /* Version read */
   volatile stm_word_t * volatile lock;            /* Pointer to lock (for fast access) */
@@ -205,8 +478,17 @@ typedef struct r_set {                  /* Read set */
   r_entry_t *entries;                   /* Array of entries */
   volatile int nb_entries;                       /* Number of entries */
   int size;                             /* Size of array */
+# ifdef READ_SET_INDEX
+  set_index_t index;                    /* Index of the locks read */
+# endif /* READ_SET_INDEX */
 } r_set_t;
 
+# define RS_LOCK(rs, i)                 ((rs)->entries[i].lock)
+# define RS_VERSION(rs, i)              ((rs)->entries[i].version)
+# define RS_SET(rs, i, l, v)            ((rs)->entries[i].lock = (l), (rs)->entries[i].version = (v))
+# define RS_BASE(rs)                    ((rs)->entries)
+#endif /* ! RW_SET_SOA */
+
 typedef struct w_entry {                /* Write set entry */
   union {                               /* For padding... */
     struct {
@@ -238,11 +520,47 @@ typedef struct w_set {                  /* Write set */
 #elif DESIGN == WRITE_BACK_CTL
   int nb_acquired;                      /* Number of locks acquired */
 # ifdef USE_BLOOM_FILTER
-  stm_word_t bloom;                     /* Same Bloom filter as in TL2 */
+  stm_word_t bloom[BLOOM_FILTER_WORDS]; /* Bloom filter of the addresses written */
 # endif /* USE_BLOOM_FILTER */
+# ifdef WRITE_SET_INDEX
+  set_index_t index;                    /* Index of the addresses written */
+# endif /* WRITE_SET_INDEX */
 #endif /* DESIGN == WRITE_BACK_CTL */
 } w_set_t;
 
+#ifdef SUPPORTER_COMMIT_LOG
+typedef struct commit_log_entry {       /* Lock released by a commit */
+  stm_word_t idx;                       /* Index of the lock */
+  stm_word_t ts;                        /* Commit timestamp */
+} commit_log_entry_t;
+
+typedef struct commit_log_record {      /* Committer of a timestamp */
+  volatile stm_word_t ts;               /* Timestamp (COMMIT_LOG_BUSY while written) */
+  volatile stm_word_t info;             /* Log position after the commit and slot of the committer */
+} commit_log_record_t;
+#endif /* SUPPORTER_COMMIT_LOG */
+
+#ifdef SUPPORTER_THREAD
+typedef struct supporter_mailbox {      /* Written by supporters only (own cache lines) */
+  volatile stm_word_t verdict;          /* Last verdict (see VERDICT()) */
+  volatile stm_word_t validator;        /* Is a supporter validating this transaction? */
+  unsigned long validations;            /* Validations by supporters */
+  unsigned long validation_lag;         /* Sum of commits behind upon supporter validation */
+  unsigned long validation_lag_max;     /* Maximum commits behind upon supporter validation */
+  stm_word_t abort_score;               /* Recent aborts and dooms (decaying average, 0..1024) */
+  unsigned long seen_aborts;            /* Aborts of the worker at the last validation */
+# ifdef SUPPORTER_THREAD_TIMERS
+  volatile stm_time_t doom_time;        /* When the supporter found the transaction invalid */
+# endif /* SUPPORTER_THREAD_TIMERS */
+# ifdef SUPPORTER_DOOM_SIGNAL
+  unsigned long doom_signals;           /* Dooms delivered by a signal */
+# endif /* SUPPORTER_DOOM_SIGNAL */
+# if CM == CM_DELAY || CM == CM_MODULAR
+  volatile stm_word_t doom_stripe;      /* Stripe that invalidated the doomed attempt (index + 1, 0 if unknown) */
+# endif /* CM == CM_DELAY || CM == CM_MODULAR */
+} supporter_mailbox_t;
+#endif /* SUPPORTER_THREAD */
+
 typedef struct cb_entry {               /* Callback entry */
   void (*f)(TXPARAMS void *);           /* Function */
   void *arg;                            /* Argument to be passed to function */
@@ -262,6 +580,17 @@ typedef struct stm_tx {                 /* Transaction descriptor */
   w_set_t w_set;                        /* Write set */
   unsigned int ro:1;                    /* Is this execution read-only? */
   unsigned int can_extend:1;            /* Can this transaction be extended? */
+#if CLOCK_SCHEME == CLOCK_GV6
+  unsigned long clock_commits;          /* Update commits (one in CLOCK_GV6_PERIOD stores the clock) */
+#elif CLOCK_SCHEME == CLOCK_NODE
+  union clock_node *clock_node;         /* Combining slot of the node of the thread */
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
+#ifdef GROUP_COMMIT
+  struct stm_tx *group_next;            /* Next commit waiting to be combined */
+  volatile stm_word_t group_state;      /* Outcome of our commit (GROUP_PENDING while waiting) */
+  unsigned long group_batches;          /* Batches of commits combined by the thread */
+  unsigned long group_commits;          /* Commits written back in these batches */
+#endif /* GROUP_COMMIT */
 
 #ifdef IRREVOCABLE_ENABLED
   unsigned int irrevocable:4;           /* Is this execution irrevocable? */
@@ -269,6 +598,13 @@ typedef struct stm_tx {                 /* Transaction descriptor */
 #ifdef HYBRID_ASF
   unsigned int software:1;              /* Is the transaction mode pure software? */
 #endif /* HYBRID_ASF */
+#ifdef MULTI_VERSION
+  int mv_snapshot;                      /* Is this execution reading its start snapshot? */
+  int mv_fallback;                      /* Did the snapshot miss a version (retry with the latest versions)? */
+  unsigned long mv_reads;               /* Loads served from old versions */
+  unsigned long mv_misses;              /* Snapshots that missed an old version */
+  unsigned long mv_kept;                /* Old versions kept upon commit */
+#endif /* MULTI_VERSION */
   int nesting;                          /* Nesting level */
   void *data[MAX_SPECIFIC];             /* Transaction-specific data (fixed-size array for better speed) */
   struct stm_tx *next;                  /* For keeping track of all transactional threads */
@@ -278,10 +614,16 @@ typedef struct stm_tx {                 /* Transaction descriptor */
 #if CM == CM_DELAY || CM == CM_MODULAR
   volatile stm_word_t *c_lock;          /* Pointer to contented lock (cause of abort) */
 #endif /* CM == CM_DELAY || CM == CM_MODULAR */
-#if CM == CM_BACKOFF
+#if CM == CM_BACKOFF || CM == CM_MODULAR
   unsigned long backoff;                /* Maximum backoff duration */
   unsigned long seed;                   /* RNG seed */
-#endif /* CM == CM_BACKOFF */
+#endif /* CM == CM_BACKOFF || CM == CM_MODULAR */
+#if CM == CM_MODULAR
+  int cm_flags;                         /* What to do before restarting (STM_CM_DELAY, STM_CM_BACKOFF) */
+  stm_word_t cm_ts;                     /* Start timestamp of the first attempt (timestamp policy) */
+  unsigned long cm_karma;               /* Accesses of the aborted attempts (karma policy) */
+  volatile stm_word_t *cm_doom_lock;    /* Stripe that doomed the previous attempt (supporter policy) */
+#endif /* CM == CM_MODULAR */
 #if CM == CM_MODULAR || defined(INTERNAL_STATS) || defined(HYBRID_ASF)
   unsigned long retries;                /* Number of consecutive aborts (retries) */
 #endif /* CM == CM_MODULAR || defined(INTERNAL_STATS) || defined(HYBRID_ASF) */
@@ -303,18 +645,51 @@ typedef struct stm_tx {                 /* Transaction descriptor */
   unsigned long max_retries;            /* Maximum number of consecutive aborts (retries) */
 #endif /* INTERNAL_STATS */
 #ifdef SUPPORTER_THREAD
-  volatile int current_run_checked;
-  volatile stm_word_t new_start_timestamp;
-  int aborts_supporter_validate_read;
-  int error;
-  int extended;
-  int total_prepares;
-  int total_aborts;
-  int total_commits;
+  volatile stm_word_t attempt;          /* Attempts started (tags the verdicts) */
+  unsigned long aborts_supporter_validate_read; /* Attempts aborted because of a supporter verdict */
+  unsigned long error;
+  unsigned long extended;               /* Snapshot extensions taken from a supporter verdict */
+  unsigned long self_extended;          /* Snapshot extensions validated by the worker itself */
+  unsigned long total_prepares;
+  unsigned long total_aborts;
+  unsigned long total_commits;
+# ifdef SUPPORTER_THREAD_TIMERS
+  unsigned long doom_latency[SUPPORTER_LATENCY_BUCKETS]; /* Ticks from doom verdict to abort */
+  unsigned long lock_wait_latency[SUPPORTER_LATENCY_BUCKETS]; /* Ticks waited on locked stripes */
+# endif /* SUPPORTER_THREAD_TIMERS */
   int aborted;
-  volatile int should_abort;
   volatile int running_transaction;
   volatile int current_thread_terminated;
+  int slot;                             /* Slot in the registry (-1 if none) */
+  struct supporter_group *group;        /* Group of the slot (NULL if unsupported) */
+  int ro_logged;                        /* Read-only transaction logging its reads for the supporters */
+  unsigned long ro_supported;           /* Read-only transactions committed with a read log */
+  unsigned long supporter_wakeups;      /* Commits that had to wake up parked supporters */
+  unsigned long lock_waits;             /* Waits on stripes locked by a committing transaction */
+  unsigned long lock_wait_aborts;       /* Waits that gave up and aborted */
+  unsigned long lock_wait_parks;        /* Sleeps until the lock owner released its locks */
+#ifdef ATS
+  struct ats_block *ats_block;          /* Atomic block whose turn we hold (NULL if none) */
+  unsigned long ats_queued;             /* Transactions queued behind other instances of their block */
+#endif /* ATS */
+#ifdef SUPPORTER_PREACQUIRE
+  volatile stm_word_t acq_next;         /* Generation and next write set chunk to lock */
+  volatile stm_word_t acq_done;         /* Write set chunks processed */
+  volatile stm_word_t acq_locked;       /* Commit locks acquired (by all threads) */
+  volatile int acq_failed;              /* Was a commit lock owned by another transaction? */
+  int acq_chunks;                       /* Number of write set chunks */
+  unsigned int acq_gen;                 /* Commit generation */
+  unsigned long preacquired;            /* Commits that shared lock acquisition with supporters */
+#endif /* SUPPORTER_PREACQUIRE */
+#ifdef SUPPORTER_DOOM_SIGNAL
+  pthread_t thread;                     /* Thread running the transactions (to deliver dooms) */
+  volatile int async_abort;             /* Can the transaction be aborted by a signal? */
+#endif /* SUPPORTER_DOOM_SIGNAL */
+#ifdef SUPPORTER_COMMIT_LOG
+  volatile stm_word_t clog_head;        /* Number of entries ever published in the commit log */
+  commit_log_entry_t clog[COMMIT_LOG_SIZE]; /* Ring of locks released by the last commits */
+  stm_word_t r_sig[READ_SIG_WORDS];     /* Signature of the locks in the read set */
+#endif /* SUPPORTER_COMMIT_LOG */
 
 #ifdef SUPPORTER_THREAD_TIMERS
   stm_time_t first_start_tx_time;
@@ -323,30 +698,240 @@ typedef struct stm_tx {                 /* Transaction descriptor */
   stm_time_t total_no_tx_time;
   stm_time_t total_tx_wasted_time;
   stm_time_t total_tx_time;
+  stm_time_t total_tx_doomed_time;      /* Time spent running doomed transactions */
 #endif /* ! SUPPORTER_THREAD_TIMERS */
 
+  /* Keep the lines written by supporters away from those of the worker */
+  char mailbox_pad_before[SUPPORTER_CACHELINE];
+  supporter_mailbox_t mailbox;
+  char mailbox_pad_after[SUPPORTER_CACHELINE];
+
+  /* Written by the transactions waiting for our locks */
+  volatile int release_seq;             /* Bumped when releasing locks that have waiters */
+  volatile stm_word_t lock_waiters;     /* Transactions asleep on release_seq */
+  char waiters_pad_after[SUPPORTER_CACHELINE];
+
 #endif /* ! SUPPORTER_THREAD */
 } stm_tx_t;
 
 #ifdef SUPPORTER_THREAD
-  typedef struct _run_supporter_thread_data_t {
-	  int base_thread_id;
-	  int supported_threads;
-    int num_tm_threads;
-  } run_supporter_thread_data_t;
+enum {                                  /* Supporter pool policies */
+  SUPPORTER_POOL_FIXED = 0,             /* SUPPORTER_INITIAL_PER_GROUP supporters per group */
+  SUPPORTER_POOL_ADAPTIVE = 1           /* Resized by the supervisor according to contention */
+};
+
+enum {                                  /* Supporter wait policies (when no commit happens) */
+  SUPPORTER_WAIT_SPIN = 0,              /* Spin on the clock */
+  SUPPORTER_WAIT_YIELD = 1,             /* Spin, then yield the CPU */
+  SUPPORTER_WAIT_PARK = 2               /* Spin, then sleep until the next commit */
+};
+
+enum {                                  /* Supporter scheduling policies */
+  SUPPORTER_SCHED_RR = 0,               /* Worker slots in index order */
+  SUPPORTER_SCHED_LARGEST = 1,          /* Largest read set first */
+  SUPPORTER_SCHED_OLDEST = 2,           /* Oldest start timestamp first */
+  SUPPORTER_SCHED_ABORT = 3,            /* Most likely to abort (recent history) first */
+  NB_SUPPORTER_SCHED = 4
+};
+
+enum {                                  /* Lock wait policies (stripe locked by a committing transaction) */
+  LOCK_WAIT_SPIN = 0,                   /* Spin until the lock is released */
+  LOCK_WAIT_ABORT = 1,                  /* Spin, yield, then abort */
+  LOCK_WAIT_OWNER = 2                   /* Spin, yield, then sleep until the owner releases its locks */
+};
+
+#ifdef ATS
+typedef struct ats_block {              /* Scheduling state of an atomic block */
+  volatile stm_word_t intensity;        /* Contention intensity (moving average of aborts, ATS_ONE = 1) */
+  volatile stm_word_t next;             /* Next ticket */
+  volatile unsigned int serving;        /* Ticket allowed to run (futex word) */
+  volatile stm_word_t waiters;          /* Transactions asleep on serving */
+  char padding[SUPPORTER_CACHELINE];
+} ats_block_t;
+#endif /* ATS */
+
+typedef struct supporter_stats {        /* Aggregate supporter statistics */
+  unsigned long passes;                 /* Validation passes */
+  unsigned long stale_passes;           /* Passes that ended after a newer commit */
+  unsigned long validations;            /* Transactions validated */
+  unsigned long entries;                /* Read set entries validated */
+  unsigned long dooms;                  /* Attempts aborted because of a verdict */
+  unsigned long extensions;             /* Extensions taken from a verdict */
+  unsigned long self_extensions;        /* Extensions validated by the workers */
+  unsigned long doom_latency[SUPPORTER_LATENCY_BUCKETS]; /* Ticks from doom verdict to abort */
+  unsigned long lock_waits;             /* Waits of the workers on locked stripes */
+  unsigned long lock_wait_aborts;       /* ... that gave up and aborted */
+  unsigned long lock_wait_parks;        /* Sleeps on lock owners */
+  unsigned long lock_wait_latency[SUPPORTER_LATENCY_BUCKETS]; /* Ticks waited on locked stripes */
+  unsigned long ats_queued;             /* Transactions queued behind their atomic block */
+  unsigned long mv_reads;               /* Loads of snapshots served from old versions */
+  unsigned long mv_misses;              /* Snapshots that missed an old version */
+  unsigned long mv_kept;                /* Old versions kept upon commit */
+  unsigned long group_batches;          /* Batches of combined commits */
+  unsigned long group_commits;          /* Commits written back in batches */
+} supporter_stats_t;
+
+typedef struct supporter_task {         /* Transaction to validate during a pass */
+  int slot;                             /* Worker slot */
+  stm_word_t key;                       /* Priority (highest first) */
+} supporter_task_t;
+
+enum {                                  /* Supporter thread states */
+  SUPPORTER_IDLE = 0,                   /* Never started */
+  SUPPORTER_RUNNING = 1,                /* Validating transactions of its group */
+  SUPPORTER_PARKED = 2,                 /* Sleeping until the supervisor needs it */
+  SUPPORTER_RETIRED = 3,                /* Thread has exited (can be started again) */
+  SUPPORTER_PAUSED = 4                  /* Waiting for stm_supporters_resume() */
+};
+
+struct supporter_group;
+
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+typedef struct supporter_chunk_job {    /* Read set split among supporters */
+  stm_tx_t *tx;                         /* Transaction being validated */
+  r_set_t rs;                           /* Read set (snapshot) */
+  int nb_entries;                       /* Read set size (snapshot) */
+  int nb_chunks;                        /* Number of chunks */
+  stm_word_t end;                       /* Timestamp validated against */
+  unsigned int gen;                     /* Job generation */
+  volatile stm_word_t next;             /* Generation and next chunk to claim */
+  volatile stm_word_t done;             /* Chunks validated */
+  volatile int failed;                  /* Has a chunk failed? */
+} supporter_chunk_job_t;
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+
+typedef struct supporter {              /* Supporter thread */
+  struct supporter_group *group;        /* Group of workers it validates */
+  int rank;                             /* Rank within the group */
+  int cpu;                              /* CPU the supporter is pinned to (-1 if none) */
+  volatile int state;                   /* Current state (protected by supporter_mutex) */
+  pthread_t thread;                     /* Thread identifier (unless idle) */
+  unsigned long waits_spin;             /* Waits for a commit that ended while spinning */
+  unsigned long waits_park;             /* Waits for a commit that yielded or parked */
+  stm_time_t parked_time;               /* Time spent yielding or parked */
+  supporter_task_t *tasks;              /* Transactions of the current pass */
+  int pass_policy;                      /* Scheduling policy of the current pass */
+  stm_time_t pass_start;                /* When the current pass started */
+  unsigned long sched_validations[NB_SUPPORTER_SCHED]; /* Validations per scheduling policy */
+  unsigned long sched_dooms[NB_SUPPORTER_SCHED];       /* Dooms per scheduling policy */
+  unsigned long sched_wasted[NB_SUPPORTER_SCHED];      /* Verdicts published after the attempt ended */
+  unsigned long sched_detect_lag[NB_SUPPORTER_SCHED];  /* Commits behind upon doom (sum) */
+  stm_time_t sched_detect_time[NB_SUPPORTER_SCHED];    /* Time from pass start to doom (sum) */
+  unsigned long passes;                 /* Validation passes over the share of the group */
+  unsigned long stale_passes;           /* Passes that ended after a newer commit */
+  unsigned long validations;            /* Transactions validated */
+  unsigned long entries;                /* Read set entries validated (full validations) */
+#ifdef SUPPORTER_WORK_STEALING
+  volatile stm_word_t dq_top;           /* Next task to steal */
+  volatile stm_word_t dq_bottom;        /* Next free task slot */
+  int dq_tasks[SUPPORTER_DEQUE_SIZE];   /* Worker slots to validate */
+  unsigned long steals;                 /* Validations stolen from other supporters */
+  unsigned long steal_attempts;         /* Deques probed for stealing */
+#endif /* SUPPORTER_WORK_STEALING */
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+  supporter_chunk_job_t job;            /* Large read set being validated */
+  unsigned long validations_parallel;   /* Read sets validated by chunks */
+  unsigned long chunks_helped;          /* Chunks validated for other supporters */
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_COMMIT_LOG
+  unsigned long validations_log;        /* Validations done from the commit logs */
+  unsigned long validations_full;       /* Validations that rescanned the read set */
+  unsigned long log_unlogged;           /* Full validations due to unlogged writes */
+  unsigned long log_pending;            /* Full validations due to commits not yet in the index */
+  unsigned long log_overrun;            /* Full validations due to overwritten index or log entries */
+  unsigned long log_hits;               /* Full validations due to read signature hits */
+#endif /* SUPPORTER_COMMIT_LOG */
+#ifdef SUPPORTER_PREACQUIRE
+  unsigned long locks_acquired;         /* Commit locks acquired on behalf of workers */
+#endif /* SUPPORTER_PREACQUIRE */
+} supporter_t;
+
+typedef struct supporter_group {        /* Workers sharing the same supporters */
+  int base_thread_id;                   /* First worker slot of the group */
+  int supported_threads;                /* Number of worker slots in the group */
+  volatile int active;                  /* Supporters allowed to run (ranks 0..active-1) */
+  int low_periods;                      /* Consecutive periods without contention */
+  unsigned long last_commits;           /* Counters at previous supervisor period */
+  unsigned long last_aborts;
+  unsigned long last_extended;
+  unsigned long last_supporter_aborts;
+  supporter_t supporters[SUPPORTER_MAX_PER_GROUP];
+} supporter_group_t;
+
 //statistics
-int aborts_supporter_validate_read=0;
-int error=0;
-int extended=0;
-int total_aborts=0;
-int total_commits=0;
-int total_prepares=0;
+unsigned long aborts_supporter_validate_read=0;
+unsigned long error=0;
+unsigned long extended=0;
+unsigned long self_extended=0;
+unsigned long total_aborts=0;
+unsigned long total_commits=0;
+unsigned long total_prepares=0;
+unsigned long supporter_doom_latency[SUPPORTER_LATENCY_BUCKETS];
+unsigned long supporter_passes=0;
+unsigned long supporter_stale_passes=0;
+unsigned long supporter_entries=0;
+int supporter_starts=0;
+int supporter_parks=0;
+int supporter_retires=0;
+unsigned long supporter_waits_spin=0;
+unsigned long supporter_waits_park=0;
+unsigned long supporter_wakeups=0;
+stm_time_t supporter_parked_time=0;
+unsigned long supporter_validations=0;
+unsigned long supporter_validation_lag=0;
+unsigned long supporter_validation_lag_max=0;
+#ifdef SUPPORTER_WORK_STEALING
+unsigned long supporter_steals=0;
+unsigned long supporter_steal_attempts=0;
+#endif /* SUPPORTER_WORK_STEALING */
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+unsigned long supporter_validations_parallel=0;
+unsigned long supporter_chunks_helped=0;
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_COMMIT_LOG
+unsigned long supporter_validations_log=0;
+unsigned long supporter_validations_full=0;
+unsigned long supporter_log_unlogged=0;
+unsigned long supporter_log_pending=0;
+unsigned long supporter_log_overrun=0;
+unsigned long supporter_log_hits=0;
+#endif /* SUPPORTER_COMMIT_LOG */
+#ifdef SUPPORTER_PREACQUIRE
+unsigned long supporter_preacquired=0;
+unsigned long supporter_locks_acquired=0;
+#endif /* SUPPORTER_PREACQUIRE */
+#ifdef SUPPORTER_DOOM_SIGNAL
+unsigned long supporter_doom_signals=0;
+#endif /* SUPPORTER_DOOM_SIGNAL */
+unsigned long supporter_ro_supported=0;
+unsigned long lock_waits=0;
+unsigned long lock_wait_aborts=0;
+unsigned long lock_wait_parks=0;
+#ifdef ATS
+unsigned long ats_queued=0;
+#endif /* ATS */
+#ifdef MULTI_VERSION
+unsigned long mv_reads=0;
+unsigned long mv_misses=0;
+unsigned long mv_kept=0;
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+unsigned long group_batches=0;
+unsigned long group_commits=0;
+#endif /* GROUP_COMMIT */
+unsigned long lock_wait_latency[SUPPORTER_LATENCY_BUCKETS];
+unsigned long supporter_sched_validations[NB_SUPPORTER_SCHED];
+unsigned long supporter_sched_dooms[NB_SUPPORTER_SCHED];
+unsigned long supporter_sched_wasted[NB_SUPPORTER_SCHED];
+unsigned long supporter_sched_detect_lag[NB_SUPPORTER_SCHED];
+stm_time_t supporter_sched_detect_time[NB_SUPPORTER_SCHED];
 #endif /* ! SUPPORTER_THREAD */
 
 #ifdef SUPPORTER_THREAD_TIMERS
 stm_time_t total_no_tx_time;
 stm_time_t total_tx_wasted_time;
 stm_time_t total_tx_time;
+stm_time_t total_tx_doomed_time;
 #endif /* ! SUPPORTER_THREAD_TIMERS */
 
 static int nb_specific = 0;             /* Number of specific slots used (<= MAX_SPECIFIC) */
@@ -457,33 +1042,31 @@ static pthread_key_t thread_tx;
  *   - The high order bits contain the commit time.
  *   - The low order bits contain an incarnation number (incremented
  *     upon abort while writing the covered memory addresses).
- * When visible reads are enabled, two bits are used as read and write
- * locks. A read-locked address can be read by an invisible reader.
  */
 
-#if CM == CM_MODULAR
-# define OWNED_BITS                     2                   /* 2 bits */
-# define WRITE_MASK                     0x01                /* 1 bit */
-# define READ_MASK                      0x02                /* 1 bit */
-# define OWNED_MASK                     (WRITE_MASK | READ_MASK)
-#else /* CM != CM_MODULAR */
-# define OWNED_BITS                     1                   /* 1 bit */
-# define WRITE_MASK                     0x01                /* 1 bit */
-# define OWNED_MASK                     (WRITE_MASK)
-#endif /* CM != CM_MODULAR */
+#define OWNED_BITS                      1                   /* 1 bit */
+#define WRITE_MASK                      0x01                /* 1 bit */
+#define OWNED_MASK                      (WRITE_MASK)
+#if DESIGN == WRITE_THROUGH
+# define INCARNATION_BITS               3                   /* 3 bits */
+# define INCARNATION_MAX                ((1 << INCARNATION_BITS) - 1)
+# define INCARNATION_MASK               (INCARNATION_MAX << 1)
+# define LOCK_BITS                      (OWNED_BITS + INCARNATION_BITS)
+#else /* DESIGN != WRITE_THROUGH */
 # define LOCK_BITS                      (OWNED_BITS)
+#endif /* DESIGN != WRITE_THROUGH */
 #define MAX_THREADS                     8192                /* Upper bound (large enough) */
-#define VERSION_MAX                     ((~(stm_word_t)0 >> LOCK_BITS) - MAX_THREADS)
+#ifdef RW_SET_SOA
+/* Versions are stored on 32 bits in the read set (the clock rolls over earlier) */
+# define VERSION_MAX                    ((stm_word_t)UINT32_MAX - MAX_THREADS)
+#else /* ! RW_SET_SOA */
+# define VERSION_MAX                    ((~(stm_word_t)0 >> LOCK_BITS) - MAX_THREADS)
+#endif /* ! RW_SET_SOA */
 
 #define LOCK_GET_OWNED(l)               (l & OWNED_MASK)
 #define LOCK_GET_WRITE(l)               (l & WRITE_MASK)
 #define LOCK_SET_ADDR_WRITE(a)          (a | WRITE_MASK)    /* WRITE bit set */
 #define LOCK_GET_ADDR(l)                (l & ~(stm_word_t)OWNED_MASK)
-#if CM == CM_MODULAR
-# define LOCK_GET_READ(l)               (l & READ_MASK)
-# define LOCK_SET_ADDR_READ(a)          (a | READ_MASK)     /* READ bit set */
-# define LOCK_UPGRADE(l)                (l | WRITE_MASK)
-#endif /* CM == CM_MODULAR */
 #if DESIGN == WRITE_THROUGH
 # define LOCK_GET_TIMESTAMP(l)          (l >> (1 + INCARNATION_BITS))
 # define LOCK_SET_TIMESTAMP(t)          (t << (1 + INCARNATION_BITS))
@@ -497,12 +1080,18 @@ static pthread_key_t thread_tx;
 #define LOCK_UNIT                       (~(stm_word_t)0)
 
 /*
- * We use the very same hash functions as TL2 for degenerate Bloom
- * filters on 32 bits.
+ * Addresses written and locks read are hashed (Fibonacci hashing of the
+ * word address) for the Bloom filter and the indexes of the read and
+ * write sets.  The filter sets two bits per address taken from the top
+ * of the hash.  Both need 64-bit words (checked above).
  */
+#define SET_HASH(a)                     (((stm_word_t)(a) >> 3) * (stm_word_t)0x9E3779B97F4A7C15ULL)
 #ifdef USE_BLOOM_FILTER
-# define FILTER_HASH(a)                 (((stm_word_t)a >> 2) ^ ((stm_word_t)a >> 5))
-# define FILTER_BITS(a)                 (1 << (FILTER_HASH(a) & 0x1F))
+# define FILTER_BITS                    (BLOOM_FILTER_WORDS * sizeof(stm_word_t) * 8)
+# define FILTER_BIT1(h)                 (((h) >> 32) % FILTER_BITS)
+# define FILTER_BIT2(h)                 (((h) >> 48) % FILTER_BITS)
+# define FILTER_WORD(b)                 ((b) / (sizeof(stm_word_t) * 8))
+# define FILTER_MASK(b)                 ((stm_word_t)1 << ((b) % (sizeof(stm_word_t) * 8)))
 #endif /* USE_BLOOM_FILTER */
 
 /*
@@ -510,6 +1099,9 @@ static pthread_key_t thread_tx;
  * We try to avoid collisions as much as possible (two addresses covered by the same lock).
  */
 #define LOCK_ARRAY_SIZE                 (1 << LOCK_ARRAY_LOG_SIZE)
+#if defined(RW_SET_SOA) && LOCK_ARRAY_LOG_SIZE > 32
+# error "RW_SET_SOA requires LOCK_ARRAY_LOG_SIZE to be at most 32"
+#endif /* defined(RW_SET_SOA) && LOCK_ARRAY_LOG_SIZE > 32 */
 #define LOCK_MASK                       (LOCK_ARRAY_SIZE - 1)
 #define LOCK_SHIFT                      (((sizeof(stm_word_t) == 4) ? 2 : 3) + LOCK_SHIFT_EXTRA)
 #define LOCK_IDX(a)                     (((stm_word_t)(a) >> LOCK_SHIFT) & LOCK_MASK)
@@ -524,6 +1116,29 @@ static pthread_key_t thread_tx;
 
 static volatile stm_word_t locks[LOCK_ARRAY_SIZE];
 
+#ifdef MULTI_VERSION
+/* Committers keep the values they overwrite, while snapshot transactions
+ * run, in a chain per stripe ordered by decreasing end of validity.  Only
+ * the owner of the lock of the stripe updates its chain.  Versions that
+ * are dropped (beyond MV_VERSIONS, or not kept because no snapshot was
+ * running) are accounted for in "forgotten": snapshots older than it may
+ * miss a version of the stripe. */
+typedef struct mv_version {             /* Old version of a word */
+  volatile stm_word_t *addr;            /* Address */
+  stm_word_t value;                     /* Value */
+  stm_word_t until;                     /* Commit timestamp of the next version */
+  struct mv_version *volatile next;     /* Older version (same stripe) */
+} mv_version_t;
+
+typedef struct mv_chain {               /* Old versions of a stripe */
+  mv_version_t *volatile head;          /* Most recent version */
+  volatile stm_word_t forgotten;        /* Most recent end of validity of a dropped version */
+} mv_chain_t;
+
+static mv_chain_t mv_chains[LOCK_ARRAY_SIZE];
+static volatile stm_word_t mv_active = 0; /* Running snapshot transactions */
+#endif /* MULTI_VERSION */
+
 /* ################################################################### *
  * CLOCK
  * ################################################################### */
@@ -540,15 +1155,422 @@ static volatile stm_word_t gclock;
 #define GET_CLOCK                       (ATOMIC_LOAD_ACQ(&CLOCK))
 #define FETCH_INC_CLOCK                 (ATOMIC_FETCH_INC_FULL(&CLOCK))
 
+#if CLOCK_SCHEME == CLOCK_GV6
+# ifndef CLOCK_GV6_PERIOD
+#  define CLOCK_GV6_PERIOD              32                  /* Commits per clock update (power of 2) */
+# endif /* ! CLOCK_GV6_PERIOD */
+#endif /* CLOCK_SCHEME == CLOCK_GV6 */
+
+#if CLOCK_SCHEME == CLOCK_NODE
+# ifndef CLOCK_NODES
+#  define CLOCK_NODES                   8                   /* Combining slots (NUMA nodes modulo CLOCK_NODES) */
+# endif /* ! CLOCK_NODES */
+
+typedef union clock_node {              /* Commits of a NUMA node waiting for a timestamp */
+  struct {
+    volatile stm_word_t arrivals;       /* Commits that asked for a timestamp */
+    volatile stm_word_t served;         /* Commits that got a timestamp */
+    volatile stm_word_t stamp;          /* Timestamp of the last batch */
+    volatile stm_word_t busy;           /* Is a commit incrementing the clock for the node? */
+  };
+  stm_word_t padding[16];               /* Two cache lines per node */
+} clock_node_t;
+
+static clock_node_t clock_nodes[CLOCK_NODES];
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
+
+#ifdef GROUP_COMMIT
+enum {                                  /* Outcome of a commit waiting in a group */
+  GROUP_IDLE = 0,
+  GROUP_PENDING = 1,                    /* Waiting to be combined */
+  GROUP_COMMITTED = 2,                  /* Written back by the combiner */
+  GROUP_ABORTED = 3                     /* Failed validation (locks still held) */
+};
+
+typedef union group_commit {            /* Commits waiting for a shared timestamp */
+  struct {
+    volatile stm_word_t pending;        /* Stack of the waiting transactions */
+    volatile stm_word_t busy;           /* Is a commit combining? */
+  };
+  stm_word_t padding[8];                /* One cache line */
+} group_commit_t;
+
+static group_commit_t commit_group;
+#endif /* GROUP_COMMIT */
+
+/*
+ * Only with CLOCK_GV1 does a commit timestamp belong to a single
+ * transaction: a transaction that gets the timestamp right after its
+ * start can skip validation.  Other schemes share timestamps between
+ * concurrent commits (which all hold their locks when the clock is
+ * incremented), so that commits must always validate.
+ */
+#if CLOCK_SCHEME == CLOCK_GV1
+# define CLOCK_EXCLUSIVE(tx, t)         ((tx)->start == (t) - 1)
+#else /* CLOCK_SCHEME != CLOCK_GV1 */
+# define CLOCK_EXCLUSIVE(tx, t)         (0)
+#endif /* CLOCK_SCHEME != CLOCK_GV1 */
+
+#if CLOCK_SCHEME == CLOCK_GV4
+/*
+ * Increment the clock unless a concurrent commit does it first, in
+ * which case its timestamp is shared (TL2 GV4).
+ */
+static inline stm_word_t clock_cas_inc()
+{
+  stm_word_t c;
+
+  c = GET_CLOCK;
+  if (ATOMIC_CAS_FULL(&CLOCK, c, c + 1))
+    return c + 1;
+  /* Incremented after we have read it (and acquired our locks) */
+  return GET_CLOCK;
+}
+#endif /* CLOCK_SCHEME == CLOCK_GV4 */
+
+#if CLOCK_SCHEME == CLOCK_NODE
+/*
+ * Get a timestamp for a commit on a node: the first commit to take the
+ * node increments the clock once for all the commits of the node that
+ * have arrived, which are served together.
+ */
+static inline stm_word_t clock_node_inc(clock_node_t *n)
+{
+  stm_word_t ticket, last;
+
+  ticket = ATOMIC_FETCH_INC_FULL(&n->arrivals) + 1;
+  while (ATOMIC_LOAD_ACQ(&n->served) < ticket) {
+    if (ATOMIC_LOAD(&n->busy) == 0 && ATOMIC_CAS_FULL(&n->busy, 0, 1)) {
+      if (ATOMIC_LOAD_ACQ(&n->served) < ticket) {
+        /* All the commits that arrived so far hold their locks */
+        last = ATOMIC_LOAD_ACQ(&n->arrivals);
+        ATOMIC_STORE(&n->stamp, FETCH_INC_CLOCK + 1);
+        ATOMIC_STORE_REL(&n->served, last);
+      }
+      ATOMIC_STORE_REL(&n->busy, 0);
+    } else {
+      __asm volatile ("pause" ::: "memory");
+    }
+  }
+  /* A later batch may have overwritten the stamp: its increment is also after our arrival */
+  return ATOMIC_LOAD_ACQ(&n->stamp);
+}
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
+
+/*
+ * Make sure that the clock is not behind a version found in memory.
+ * Only lazy schemes let commits write versions ahead of the clock: the
+ * transactions that read them advance the clock before extending their
+ * snapshot (or before aborting, so that they restart after it).
+ */
+#if CLOCK_SCHEME == CLOCK_GV5 || CLOCK_SCHEME == CLOCK_GV6
+static inline void clock_advance(stm_word_t version)
+{
+  stm_word_t c;
+
+  while ((c = GET_CLOCK) < version) {
+    if (ATOMIC_CAS_FULL(&CLOCK, c, version))
+      break;
+  }
+}
+
+/*
+ * Lazy timestamp (TL2 GV5): the clock value + 1, without storing it.
+ * The versions overwritten may be ahead of the clock: the timestamp
+ * must exceed them so that a lock never gets the same version twice.
+ */
+static inline stm_word_t clock_lazy(stm_tx_t *tx)
+{
+  stm_word_t t, v;
+  w_entry_t *w;
+  int i;
+
+  t = GET_CLOCK;
+  w = tx->w_set.entries;
+  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
+# if DESIGN != WRITE_BACK_ETL
+    /* Only the entries that acquired the lock have its version */
+    if (w->no_drop)
+      continue;
+# endif /* DESIGN != WRITE_BACK_ETL */
+# if DESIGN == WRITE_THROUGH
+    v = LOCK_GET_TIMESTAMP(w->version);
+# else /* DESIGN != WRITE_THROUGH */
+    v = w->version;
+# endif /* DESIGN != WRITE_THROUGH */
+    if (v > t)
+      t = v;
+  }
+  return t + 1;
+}
+#else /* CLOCK_SCHEME != CLOCK_GV5 && CLOCK_SCHEME != CLOCK_GV6 */
+# define clock_advance(version)         /* Nothing */
+#endif /* CLOCK_SCHEME != CLOCK_GV5 && CLOCK_SCHEME != CLOCK_GV6 */
+
+/*
+ * Get the timestamp of a commit (may exceed VERSION_MAX by up to
+ * MAX_THREADS).  Must be called once all the locks of the commit are
+ * held.  The transaction is NULL for unit stores, which advance the
+ * clock up to the version they overwrite beforehand.
+ */
+static inline stm_word_t clock_commit(stm_tx_t *tx)
+{
+#if CLOCK_SCHEME == CLOCK_GV1
+  return FETCH_INC_CLOCK + 1;
+#elif CLOCK_SCHEME == CLOCK_GV4
+  return clock_cas_inc();
+#elif CLOCK_SCHEME == CLOCK_GV5
+  /* Readers of the new versions advance the clock */
+  if (tx == NULL)
+    return GET_CLOCK + 1;
+  return clock_lazy(tx);
+#elif CLOCK_SCHEME == CLOCK_GV6
+  stm_word_t t;
+
+  if (tx == NULL)
+    return GET_CLOCK + 1;
+  t = clock_lazy(tx);
+  /* Store the clock once in a while (as GV5 otherwise) */
+  if ((++tx->clock_commits & (CLOCK_GV6_PERIOD - 1)) == 0)
+    clock_advance(t);
+  return t;
+#elif CLOCK_SCHEME == CLOCK_NODE
+  if (tx == NULL)
+    return FETCH_INC_CLOCK + 1;
+  return clock_node_inc(tx->clock_node);
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
+}
+
 #ifdef SUPPORTER_THREAD
 
 /* ################################################################### *
  * SUPPORTER THREAD
  * ################################################################### */
 
-pthread_spinlock_t stm_tx_pointers_spinlock;
+static pthread_mutex_t stm_stats_mutex; /* Protects the aggregation of thread statistics */
+
+static int supporter_ratio = SUPPORTER_RATIO;
+static int supporter_cpus = SUPPORTER_CPUS;
+static int supporter_pool_policy = SUPPORTER_POOL;
+static const char *supporter_pool_names[] = { "fixed", "adaptive" };
+static int supporter_placement = SUPPORTER_PLACEMENT;
+
+/* Groups are created when the first worker of their range of slots
+ * registers, and are only freed by stm_exit() (or when the ratio
+ * changes while no worker is registered). */
+static supporter_group_t **supporter_groups = NULL; /* Group index => group (NULL if none) */
+static volatile int nb_supporter_groups = 0; /* Highest group index in use + 1 */
+static pthread_mutex_t supporter_mutex;  /* Protects supporter states and pool sizes */
+static pthread_cond_t supporter_cond;    /* Wakes up parked supporters and the supervisor */
+static volatile int supporter_stop = 0;
+static volatile int supporter_paused = 0; /* Pending pauses (protected by supporter_mutex) */
+static int supporter_running = 0;        /* Have the supporters been started? */
+static pthread_t supervisor_thread;
+static int supervisor_running = 0;
+
+static int supporter_wait_policy = SUPPORTER_WAIT;
+static int supporter_spin_budget = SUPPORTER_SPIN_BUDGET;
+static const char *supporter_wait_names[] = { "spin", "yield", "park" };
+static int supporter_sched_policy = SUPPORTER_SCHEDULE;
+static const char *supporter_sched_names[] = { "rr", "largest", "oldest", "abort" };
+static int lock_wait_policy = LOCK_WAIT;
+static int lock_spin_budget = LOCK_SPIN_BUDGET;
+static const char *lock_wait_names[] = { "spin", "abort", "owner" };
+#ifdef ATS
+static int ats_threshold = ATS_THRESHOLD;
+static ats_block_t ats_blocks[ATS_BLOCKS];
+#endif /* ATS */
+#if CM == CM_MODULAR
+static int cm_policy = CM_POLICY;
+static int (*cm_function)(struct stm_tx *, struct stm_tx *, int) = NULL;
+#endif /* CM == CM_MODULAR */
+
+/* Parked supporters sleep on supporter_commit_seq, which committers only
+ * bump (and wake) when supporter_sleepers is non-zero: the clock increment
+ * and the increment of supporter_sleepers are both full barriers, so either
+ * the committer sees the sleeper or the sleeper sees the new clock. */
+static volatile int supporter_commit_seq = 0;
+static volatile stm_word_t supporter_sleepers = 0;
+
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+static volatile stm_word_t supporter_chunk_jobs = 0; /* Jobs waiting for helpers */
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_PREACQUIRE
+static volatile stm_word_t supporter_lock_jobs = 0; /* Commits sharing lock acquisition */
+#endif /* SUPPORTER_PREACQUIRE */
+
+/* Registry of the transaction descriptors.  Threads claim a slot from a
+ * lock-free free list (a stack tagged against ABA) and the supporters of
+ * a group scan its dense range of slots.  Descriptors are never freed
+ * while the library runs: a thread that exits leaves its descriptor in
+ * its slot for the next thread that claims it, so supporters can always
+ * dereference a descriptor read from the registry.  The generation of a
+ * slot (odd while in use) tells a supporter whether the descriptor it
+ * validated still belongs to the same thread. */
+typedef struct tx_slot {                /* Registry slot */
+  volatile stm_tx_t *tx;                /* Registered descriptor (NULL if free) */
+  volatile stm_word_t gen;              /* Generation (odd while in use) */
+  stm_tx_t *cache;                      /* Descriptor left by the last thread */
+  int next;                             /* Next free slot */
+} tx_slot_t;
+
+#define TX_SLOT_BITS                    32                  /* Slot bits in the free list head */
+#define TX_SLOT_MASK                    (((stm_word_t)1 << TX_SLOT_BITS) - 1)
+
+static tx_slot_t stm_tx_slots[MAX_THREADS];
+static volatile stm_word_t stm_tx_free = 0; /* Tag and first free slot + 1 (0 if none) */
+static volatile stm_word_t stm_tx_slots_hwm = 0; /* Highest slot ever used + 1 */
+
+/*
+ * Fill the free list so that slots are claimed in increasing order.
+ */
+static void tx_slot_init()
+{
+  int i;
+
+  memset(stm_tx_slots, 0, sizeof(stm_tx_slots));
+  for (i = 0; i < MAX_THREADS; i++)
+    stm_tx_slots[i].next = (i + 1 < MAX_THREADS ? i + 1 : -1);
+  stm_tx_free = 1;
+  stm_tx_slots_hwm = 0;
+}
+
+/*
+ * Claim a free slot (or -1 if none is left).
+ */
+static int tx_slot_claim()
+{
+  stm_word_t h, hwm;
+  int i;
+
+  do {
+    h = ATOMIC_LOAD_ACQ(&stm_tx_free);
+    if ((h & TX_SLOT_MASK) == 0)
+      return -1;
+    i = (int)(h & TX_SLOT_MASK) - 1;
+  } while (ATOMIC_CAS_FULL(&stm_tx_free, h, (((h >> TX_SLOT_BITS) + 1) << TX_SLOT_BITS) | (stm_word_t)(stm_tx_slots[i].next + 1)) == 0);
+
+  do {
+    hwm = stm_tx_slots_hwm;
+  } while (hwm <= (stm_word_t)i && ATOMIC_CAS_FULL(&stm_tx_slots_hwm, hwm, i + 1) == 0);
+
+  return i;
+}
+
+/*
+ * Give a slot back to the free list.
+ */
+static void tx_slot_release(int i)
+{
+  stm_word_t h;
+
+  do {
+    h = ATOMIC_LOAD_ACQ(&stm_tx_free);
+    stm_tx_slots[i].next = (int)(h & TX_SLOT_MASK) - 1;
+  } while (ATOMIC_CAS_FULL(&stm_tx_free, h, (((h >> TX_SLOT_BITS) + 1) << TX_SLOT_BITS) | (stm_word_t)(i + 1)) == 0);
+}
+
+/*
+ * Free the descriptors left in the registry (once no supporter runs).
+ */
+static void tx_slot_exit()
+{
+  stm_tx_t *tx;
+  int i;
+
+  for (i = 0; i < (int)stm_tx_slots_hwm; i++) {
+    if ((tx = stm_tx_slots[i].cache) == NULL)
+      continue;
+#ifdef RW_SET_SOA
+    free(tx->r_set.idx);
+    free(tx->r_set.versions);
+#else /* ! RW_SET_SOA */
+    free(tx->r_set.entries);
+#endif /* ! RW_SET_SOA */
+#ifdef READ_SET_INDEX
+    free(tx->r_set.index.slots);
+#endif /* READ_SET_INDEX */
+    free(tx->w_set.entries);
+#if DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX)
+    free(tx->w_set.index.slots);
+#endif /* DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX) */
+    free(tx);
+    stm_tx_slots[i].cache = NULL;
+  }
+}
+
+#ifdef SUPPORTER_COMMIT_LOG
+/* Clock increments whose released locks are not in any commit log (unit
+ * stores, commit logs of threads that have exited): supporters fall back
+ * to a full validation for transactions that started before them. */
+static volatile stm_word_t commit_log_unlogged = 0; /* Unlogged writes in progress */
+static volatile stm_word_t commit_log_unlogged_ts = 0; /* Latest unlogged timestamp */
+
+static inline void commit_log_set_unlogged(stm_word_t t)
+{
+  stm_word_t u;
+
+  do {
+    u = ATOMIC_LOAD(&commit_log_unlogged_ts);
+  } while (u < t && ATOMIC_CAS_FULL(&commit_log_unlogged_ts, u, t) == 0);
+}
+
+/* Committers of the last COMMIT_LOG_INDEX_SIZE timestamps (each one is
+ * taken by a single commit with CLOCK_GV1), so that supporters only read
+ * the commit logs of the commits that happened after a transaction.  A
+ * timestamp without record (commit in progress, batch of several group
+ * commits) makes supporters fall back to a full validation. */
+static commit_log_record_t commit_log_index[COMMIT_LOG_INDEX_SIZE];
+
+/*
+ * Record the committer of timestamp t once the locks it released are in
+ * its commit log (up to position pos).  Skipped if the record has already
+ * been taken by a later timestamp.
+ */
+static inline void commit_log_publish(stm_word_t t, stm_word_t pos, int slot)
+{
+  commit_log_record_t *r = &commit_log_index[t & (COMMIT_LOG_INDEX_SIZE - 1)];
+  stm_word_t old;
+
+  old = ATOMIC_LOAD(&r->ts);
+  if (old == COMMIT_LOG_BUSY || old >= t || ATOMIC_CAS_FULL(&r->ts, old, COMMIT_LOG_BUSY) == 0)
+    return;
+  ATOMIC_STORE(&r->info, COMMIT_LOG_INFO(pos, slot));
+  ATOMIC_STORE_REL(&r->ts, t);
+}
+#endif /* SUPPORTER_COMMIT_LOG */
+
+
+static inline void supporter_futex_wait(volatile int *addr, int val, long us)
+{
+#ifdef __linux__
+  struct timespec timeout;
+
+  timeout.tv_sec = us / 1000000;
+  timeout.tv_nsec = (us % 1000000) * 1000;
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, &timeout, NULL, 0);
+#else /* ! __linux__ */
+  sched_yield();
+#endif /* ! __linux__ */
+}
+
+static inline void supporter_futex_wake(volatile int *addr)
+{
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif /* __linux__ */
+}
 
-static volatile stm_tx_t* stm_tx_pointers[MAX_THREADS];
+/*
+ * Wake up all supporters sleeping on a commit.  Racing committers may lose
+ * increments, but the sequence number changes anyway, which is all
+ * FUTEX_WAIT needs.
+ */
+static inline void supporter_wake()
+{
+  supporter_commit_seq++;
+  supporter_futex_wake(&supporter_commit_seq);
+}
 
 #endif /* ! SUPPORTER_THREAD */
 
@@ -773,80 +1795,380 @@ static inline void stm_quiesce_release(stm_tx_t *tx)
 /*
  * Reset clock and timestamps
  */
+#ifdef SUPPORTER_THREAD
+static void supporter_pool_pause();
+static void supporter_pool_resume();
+#endif /* SUPPORTER_THREAD */
+
+#ifdef MULTI_VERSION
+/*
+ * Drop the old versions of a stripe from a link of its chain on (the
+ * caller owns the lock of the stripe).  Snapshots still traversing them
+ * started before the cut, hence they are freed by the garbage collector
+ * once these snapshots are over.
+ */
+static inline void mv_drop(mv_chain_t *c, mv_version_t *volatile *link)
+{
+  mv_version_t *v, *next;
+  stm_word_t t;
+
+  if ((v = *link) == NULL)
+    return;
+  /* The first dropped version is the most recent */
+  if (v->until > c->forgotten)
+    ATOMIC_STORE(&c->forgotten, v->until);
+  ATOMIC_STORE_REL(link, NULL);
+  t = GET_CLOCK;
+  for (; v != NULL; v = next) {
+    next = v->next;
+    gc_free(v, t);
+  }
+}
+
+/*
+ * Record that the version of a stripe overwritten at timestamp t is not
+ * kept (the caller owns the lock of the stripe).
+ */
+static inline void mv_forget(mv_chain_t *c, stm_word_t t)
+{
+  if (t > c->forgotten)
+    ATOMIC_STORE(&c->forgotten, t);
+}
+
+/*
+ * Keep the value of a word overwritten by a commit at timestamp t, for
+ * the snapshots that started before (the caller owns the lock of the
+ * stripe).
+ */
+static inline void mv_keep(stm_tx_t *tx, volatile stm_word_t *lock, volatile stm_word_t *addr, stm_word_t value, stm_word_t t)
+{
+  mv_chain_t *c = &mv_chains[lock - locks];
+  mv_version_t *v, *volatile *link;
+  int n;
+
+  /* Snapshots register before reading the clock, hence those starting
+   * later either have a newer start or see the version forgotten */
+  if (ATOMIC_LOAD(&mv_active) == 0) {
+    mv_forget(c, t);
+    mv_drop(c, &c->head);
+    return;
+  }
+  if ((v = (mv_version_t *)malloc(sizeof(mv_version_t))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  v->addr = addr;
+  v->value = value;
+  v->until = t;
+  v->next = c->head;
+  ATOMIC_STORE_REL(&c->head, v);
+  tx->mv_kept++;
+  /* Bound the number of versions */
+  link = &v->next;
+  for (n = 1; *link != NULL && n < MV_VERSIONS; n++)
+    link = &(*link)->next;
+  mv_drop(c, link);
+}
+
+/*
+ * End the snapshot of a transaction (if any).
+ */
+static inline void mv_end(stm_tx_t *tx)
+{
+  if (tx->mv_snapshot) {
+    tx->mv_snapshot = 0;
+    ATOMIC_FETCH_DEC_FULL(&mv_active);
+  }
+}
+
+/*
+ * Free all old versions (no transaction may be running).
+ */
+static void mv_reset()
+{
+  mv_version_t *v, *next;
+  int i;
+
+  for (i = 0; i < LOCK_ARRAY_SIZE; i++) {
+    for (v = mv_chains[i].head; v != NULL; v = next) {
+      next = v->next;
+      free(v);
+    }
+    mv_chains[i].head = NULL;
+    mv_chains[i].forgotten = 0;
+  }
+}
+#endif /* MULTI_VERSION */
+
 static inline void rollover_clock(void *arg)
 {
   PRINT_DEBUG("==> rollover_clock()\n");
 
+#ifdef SUPPORTER_THREAD
+  /* Supporters read the clock and the locks: keep them away meanwhile */
+  supporter_pool_pause();
+#endif /* SUPPORTER_THREAD */
   /* Reset clock */
   CLOCK = 0;
+#if CLOCK_SCHEME == CLOCK_NODE
+  memset(clock_nodes, 0, sizeof(clock_nodes));
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
   /* Reset timestamps */
   memset((void *)locks, 0, LOCK_ARRAY_SIZE * sizeof(stm_word_t));
+#ifdef MULTI_VERSION
+  /* Old versions refer to the previous timestamps */
+  mv_reset();
+#endif /* MULTI_VERSION */
 # ifdef EPOCH_GC
   /* Reset GC */
   gc_reset();
 # endif /* EPOCH_GC */
+#ifdef SUPPORTER_COMMIT_LOG
+  /* Unlogged writes and indexed commits all happened before the reset */
+  commit_log_unlogged_ts = 0;
+  memset((void *)commit_log_index, 0, sizeof(commit_log_index));
+#endif /* SUPPORTER_COMMIT_LOG */
+#ifdef SUPPORTER_THREAD
+  supporter_pool_resume();
+#endif /* SUPPORTER_THREAD */
 }
 
+#if defined(READ_SET_INDEX) || defined(WRITE_SET_INDEX)
 /*
- * Check if stripe has been read previously.
+ * Large read and write sets are indexed by an open addressing table
+ * (linear probing, at most half full) mapping the hash of a key (lock
+ * or address) to the entry that holds it.  Slots are tagged with a
+ * generation so that the table is cleared in constant time.
  */
-static inline r_entry_t *stm_has_read(stm_tx_t *tx, volatile stm_word_t *lock)
-{
-  r_entry_t *r;
-  int i;
-
-  PRINT_DEBUG("==> stm_has_read(%p[%lu-%lu],%p)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, lock);
+# define SET_INDEX_SLOT(ix, h)          ((h) >> (sizeof(stm_word_t) * 8 - (ix)->bits))
+# define SET_INDEX_NEXT(ix, s)          (((s) + 1) & (((stm_word_t)1 << (ix)->bits) - 1))
+# define SET_INDEX_VALID(ix, v)         (((v) >> 32) == (ix)->gen)
+# define SET_INDEX_ENTRY(v)             ((int)((v) & 0xFFFFFFFF) - 1)
 
-  /* Look for read */
-  r = tx->r_set.entries;
-  for (i = tx->r_set.nb_entries; i > 0; i--, r++) {
-    if (r->lock == lock) {
-      /* Return first match*/
-      return r;
-    }
-  }
-  return NULL;
+static inline void set_index_init(set_index_t *ix)
+{
+  ix->slots = NULL;
+  ix->bits = 0;
+  ix->nb_indexed = 0;
+  ix->gen = 0;
 }
 
-#if DESIGN == WRITE_BACK_CTL
 /*
- * Check if address has been written previously.
+ * Insert entry i with given key hash (the table must have room).
  */
-static inline w_entry_t *stm_has_written(stm_tx_t *tx, volatile stm_word_t *addr)
+static inline void set_index_put(set_index_t *ix, stm_word_t h, int i)
 {
-  w_entry_t *w;
-  int i;
-# ifdef USE_BLOOM_FILTER
-  stm_word_t mask;
-# endif /* USE_BLOOM_FILTER */
+  stm_word_t s = SET_INDEX_SLOT(ix, h);
 
-  PRINT_DEBUG("==> stm_has_written(%p[%lu-%lu],%p)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, addr);
+  /* Slots of older generations are free */
+  while (SET_INDEX_VALID(ix, ix->slots[s]))
+    s = SET_INDEX_NEXT(ix, s);
+  ix->slots[s] = (ix->gen << 32) | (stm_word_t)(i + 1);
+  ix->nb_indexed++;
+}
 
-# ifdef USE_BLOOM_FILTER
-  mask = FILTER_BITS(addr);
-  if ((tx->w_set.bloom & mask) != mask)
-    return NULL;
-# endif /* USE_BLOOM_FILTER */
+/*
+ * Invalidate the index (constant time, unless the generation wraps).
+ */
+static inline void set_index_reset(set_index_t *ix)
+{
+  if (ix->nb_indexed == 0)
+    return;
+  ix->nb_indexed = 0;
+  if (++ix->gen == ((stm_word_t)1 << 32)) {
+    memset(ix->slots, 0, sizeof(stm_word_t) << ix->bits);
+    ix->gen = 1;
+  }
+}
 
-  /* Look for write */
-  w = tx->w_set.entries;
-  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
-    if (w->addr == addr) {
-      return w;
-    }
+/*
+ * Make room for n entries.  When the table must grow, it is emptied and
+ * all the entries must be inserted again.
+ */
+static inline void set_index_reserve(set_index_t *ix, int n)
+{
+  if (ix->slots != NULL && n * 2 <= (1 << ix->bits))
+    return;
+  while (n * 2 > (1 << ix->bits))
+    ix->bits++;
+  free(ix->slots);
+  if ((ix->slots = (stm_word_t *)calloc((size_t)1 << ix->bits, sizeof(stm_word_t))) == NULL) {
+    perror("calloc set index");
+    exit(1);
   }
-  return NULL;
+  ix->gen = 1;
+  ix->nb_indexed = 0;
 }
-#endif /* DESIGN == WRITE_BACK_CTL */
+#endif /* defined(READ_SET_INDEX) || defined(WRITE_SET_INDEX) */
 
+#ifdef READ_SET_INDEX
 /*
- * (Re)allocate read set entries.
+ * Index the entries added to the read set since the last call, once the
+ * read set has reached the threshold.
  */
-static inline void stm_allocate_rs_entries(stm_tx_t *tx, int extend)
+static inline void stm_rs_index_add(r_set_t *rs)
 {
-  PRINT_DEBUG("==> stm_allocate_rs_entries(%p[%lu-%lu],%d)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, extend);
+  int i;
 
-  if (extend) {
+  if (rs->nb_entries < READ_SET_INDEX_THRESHOLD)
+    return;
+  set_index_reserve(&rs->index, rs->nb_entries);
+  /* All the entries when the threshold has just been reached */
+  for (i = rs->index.nb_indexed; i < rs->nb_entries; i++)
+    set_index_put(&rs->index, SET_HASH(RS_LOCK(rs, i)), i);
+}
+#endif /* READ_SET_INDEX */
+
+/*
+ * Clear the read set for a new attempt.
+ */
+static inline void stm_rs_reset(r_set_t *rs)
+{
+#ifdef READ_SET_INDEX
+  set_index_reset(&rs->index);
+#endif /* READ_SET_INDEX */
+  rs->nb_entries = 0;
+}
+
+/*
+ * Check if stripe has been read previously.
+ */
+static inline int stm_has_read(stm_tx_t *tx, volatile stm_word_t *lock)
+{
+  int i;
+#ifdef READ_SET_INDEX
+  set_index_t *ix = &tx->r_set.index;
+  stm_word_t s, v;
+#endif /* READ_SET_INDEX */
+
+  PRINT_DEBUG("==> stm_has_read(%p[%lu-%lu],%p)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, lock);
+
+#ifdef READ_SET_INDEX
+  if (ix->nb_indexed > 0) {
+    for (s = SET_INDEX_SLOT(ix, SET_HASH(lock)); SET_INDEX_VALID(ix, v = ix->slots[s]); s = SET_INDEX_NEXT(ix, s)) {
+      if (RS_LOCK(&tx->r_set, SET_INDEX_ENTRY(v)) == lock)
+        return 1;
+    }
+    return 0;
+  }
+#endif /* READ_SET_INDEX */
+
+  /* Look for read */
+  for (i = 0; i < tx->r_set.nb_entries; i++) {
+    if (RS_LOCK(&tx->r_set, i) == lock)
+      return 1;
+  }
+  return 0;
+}
+
+#ifdef WRITE_SET_INDEX
+/*
+ * Index the entries added to the write set since the last call, once
+ * the write set has reached the threshold.
+ */
+static inline void stm_ws_index_add(w_set_t *ws)
+{
+  int i;
+
+  if (ws->nb_entries < WRITE_SET_INDEX_THRESHOLD)
+    return;
+  set_index_reserve(&ws->index, ws->nb_entries);
+  /* All the entries when the threshold has just been reached */
+  for (i = ws->index.nb_indexed; i < ws->nb_entries; i++)
+    set_index_put(&ws->index, SET_HASH(ws->entries[i].addr), i);
+}
+#endif /* WRITE_SET_INDEX */
+
+/*
+ * Clear the write set for a new attempt.
+ */
+static inline void stm_ws_reset(w_set_t *ws)
+{
+#ifdef USE_BLOOM_FILTER
+  if (ws->nb_entries > 0)
+    memset(ws->bloom, 0, sizeof(ws->bloom));
+#endif /* USE_BLOOM_FILTER */
+#ifdef WRITE_SET_INDEX
+  set_index_reset(&ws->index);
+#endif /* WRITE_SET_INDEX */
+#if DESIGN == WRITE_BACK_CTL
+  ws->nb_acquired = 0;
+#endif /* DESIGN == WRITE_BACK_CTL */
+  ws->nb_entries = 0;
+}
+
+#if DESIGN == WRITE_BACK_CTL
+/*
+ * Check if address has been written previously.
+ */
+static inline w_entry_t *stm_has_written(stm_tx_t *tx, volatile stm_word_t *addr)
+{
+  w_entry_t *w;
+  int i;
+# if defined(USE_BLOOM_FILTER) || defined(WRITE_SET_INDEX)
+  stm_word_t h = SET_HASH(addr);
+# endif /* defined(USE_BLOOM_FILTER) || defined(WRITE_SET_INDEX) */
+# ifdef WRITE_SET_INDEX
+  set_index_t *ix = &tx->w_set.index;
+  stm_word_t s, v;
+# endif /* WRITE_SET_INDEX */
+
+  PRINT_DEBUG("==> stm_has_written(%p[%lu-%lu],%p)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, addr);
+
+# ifdef USE_BLOOM_FILTER
+  if ((tx->w_set.bloom[FILTER_WORD(FILTER_BIT1(h))] & FILTER_MASK(FILTER_BIT1(h))) == 0
+      || (tx->w_set.bloom[FILTER_WORD(FILTER_BIT2(h))] & FILTER_MASK(FILTER_BIT2(h))) == 0)
+    return NULL;
+# endif /* USE_BLOOM_FILTER */
+
+# ifdef WRITE_SET_INDEX
+  if (ix->nb_indexed > 0) {
+    for (s = SET_INDEX_SLOT(ix, h); SET_INDEX_VALID(ix, v = ix->slots[s]); s = SET_INDEX_NEXT(ix, s)) {
+      w = &tx->w_set.entries[SET_INDEX_ENTRY(v)];
+      if (w->addr == addr)
+        return w;
+    }
+    return NULL;
+  }
+# endif /* WRITE_SET_INDEX */
+
+  /* Look for write */
+  w = tx->w_set.entries;
+  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
+    if (w->addr == addr) {
+      return w;
+    }
+  }
+  return NULL;
+}
+#endif /* DESIGN == WRITE_BACK_CTL */
+
+/*
+ * (Re)allocate read set entries.
+ */
+static inline void stm_allocate_rs_entries(stm_tx_t *tx, int extend)
+{
+  PRINT_DEBUG("==> stm_allocate_rs_entries(%p[%lu-%lu],%d)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, extend);
+
+#ifdef RW_SET_SOA
+  if (extend) {
+    /* Extend read set */
+    tx->r_set.size *= 2;
+    if ((tx->r_set.idx = (uint32_t *)realloc(tx->r_set.idx, tx->r_set.size * sizeof(uint32_t))) == NULL
+        || (tx->r_set.versions = (uint32_t *)realloc(tx->r_set.versions, tx->r_set.size * sizeof(uint32_t))) == NULL) {
+      perror("realloc read set");
+      exit(1);
+    }
+  } else {
+    /* Allocate read set */
+    if ((tx->r_set.idx = (uint32_t *)malloc(tx->r_set.size * sizeof(uint32_t))) == NULL
+        || (tx->r_set.versions = (uint32_t *)malloc(tx->r_set.size * sizeof(uint32_t))) == NULL) {
+      perror("malloc read set");
+      exit(1);
+    }
+  }
+#else /* ! RW_SET_SOA */
+  if (extend) {
     /* Extend read set */
     tx->r_set.size *= 2;
     if ((tx->r_set.entries = (r_entry_t *)realloc(tx->r_set.entries, tx->r_set.size * sizeof(r_entry_t))) == NULL) {
@@ -860,6 +2182,7 @@ static inline void stm_allocate_rs_entries(stm_tx_t *tx, int extend)
       exit(1);
     }
   }
+#endif /* ! RW_SET_SOA */
 }
 
 /*
@@ -892,7 +2215,8 @@ static inline void stm_allocate_ws_entries(stm_tx_t *tx, int extend)
         nws[j].next = nws + (ows[j].next - ows);
     }
     for (j = 0; j < tx->w_set.nb_entries; j++) {
-      if (ows[j].lock == GET_LOCK(ows[j].addr)) 
+      /* The lock points to the first entry covered by it */
+      if (ATOMIC_LOAD(ows[j].lock) == LOCK_SET_ADDR_WRITE((stm_word_t)&ows[j]))
         ATOMIC_STORE_REL(ows[j].lock, LOCK_SET_ADDR_WRITE((stm_word_t)&nws[j]));
     }
     tx->w_set.entries = nws;
@@ -924,73 +2248,334 @@ static inline void stm_allocate_ws_entries(stm_tx_t *tx, int extend)
 #endif /* CM == CM_MODULAR || (defined(CONFLICT_TRACKING) && DESIGN != WRITE_THROUGH) */
 }
 
+/*
+ * Read set validation kernels.  Each kernel returns the number of leading
+ * entries (among n, starting at first) that pass a fast check; the caller handles the first failing
+ * entry (if any) with the precise scalar logic.  "versions" kernels check
+ * that locks are free and still carry the version read, "end" kernels
+ * check that lock timestamps do not exceed a given end (owned locks have
+ * a large address in place of the timestamp and always fail).
+ */
+#if DESIGN == WRITE_THROUGH
+# define VALIDATE_TS_SHIFT              (1 + INCARNATION_BITS)
+#else /* DESIGN != WRITE_THROUGH */
+# define VALIDATE_TS_SHIFT              (OWNED_BITS)
+#endif /* DESIGN != WRITE_THROUGH */
+
+enum {                                  /* Validation kernels */
+  VALIDATE_SCALAR = 0,
+  VALIDATE_AVX2 = 1,
+  VALIDATE_AVX512 = 2
+};
+
+static const char *validate_kernel_names[] = { "scalar", "avx2", "avx512" };
+
+static int validate_scalar_versions(r_set_t *rs, int first, int n)
+{
+  int i;
+  stm_word_t l;
+
+  for (i = 0; i < n; i++) {
+    l = ATOMIC_LOAD(RS_LOCK(rs, first + i));
+    if (LOCK_GET_OWNED(l) || LOCK_GET_TIMESTAMP(l) != RS_VERSION(rs, first + i))
+      break;
+  }
+  return i;
+}
+
+static int validate_scalar_end(r_set_t *rs, int first, int n, stm_word_t end)
+{
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (LOCK_GET_TIMESTAMP(ATOMIC_LOAD(RS_LOCK(rs, first + i))) > end)
+      break;
+  }
+  return i;
+}
+
+#ifdef SIMD_VALIDATION
+# ifdef RW_SET_SOA
+/* Lock indices and versions are separate 32-bit arrays: one 128-bit
+ * (resp. 256-bit) load of each gives four (resp. eight) entries, the
+ * lock words are gathered from the lock array by index and the versions
+ * are zero-extended to 64 bits. */
+__attribute__((target("avx2")))
+static int validate_avx2_versions(r_set_t *rs, int first, int n)
+{
+  __m256i ver, lw, bad;
+  const __m256i owned = _mm256_set1_epi64x(OWNED_MASK);
+  uint32_t *idx = rs->idx + first;
+  uint32_t *v = rs->versions + first;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    ver = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)&v[i]));
+    lw = _mm256_i32gather_epi64((const long long *)locks, _mm_loadu_si128((const __m128i *)&idx[i]), 8);
+    bad = _mm256_or_si256(_mm256_xor_si256(_mm256_srli_epi64(lw, VALIDATE_TS_SHIFT), ver),
+                          _mm256_and_si256(lw, owned));
+    if (!_mm256_testz_si256(bad, bad))
+      break;
+  }
+  return i + validate_scalar_versions(rs, first + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int validate_avx2_end(r_set_t *rs, int first, int n, stm_word_t end)
+{
+  __m256i lw, gt;
+  const __m256i endv = _mm256_set1_epi64x(end);
+  uint32_t *idx = rs->idx + first;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    lw = _mm256_i32gather_epi64((const long long *)locks, _mm_loadu_si128((const __m128i *)&idx[i]), 8);
+    /* Shifted timestamps are positive: signed compare is fine */
+    gt = _mm256_cmpgt_epi64(_mm256_srli_epi64(lw, VALIDATE_TS_SHIFT), endv);
+    if (!_mm256_testz_si256(gt, gt))
+      break;
+  }
+  return i + validate_scalar_end(rs, first + i, n - i, end);
+}
+
+__attribute__((target("avx512f")))
+static int validate_avx512_versions(r_set_t *rs, int first, int n)
+{
+  __m512i ver, lw;
+  const __m512i owned = _mm512_set1_epi64(OWNED_MASK);
+  uint32_t *idx = rs->idx + first;
+  uint32_t *v = rs->versions + first;
+  int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    ver = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *)&v[i]));
+    lw = _mm512_i32gather_epi64(_mm256_loadu_si256((const __m256i *)&idx[i]), (const void *)locks, 8);
+    if (_mm512_test_epi64_mask(lw, owned)
+        || _mm512_cmpneq_epu64_mask(_mm512_srli_epi64(lw, VALIDATE_TS_SHIFT), ver))
+      break;
+  }
+  return i + validate_scalar_versions(rs, first + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static int validate_avx512_end(r_set_t *rs, int first, int n, stm_word_t end)
+{
+  __m512i lw;
+  const __m512i endv = _mm512_set1_epi64(end);
+  uint32_t *idx = rs->idx + first;
+  int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    lw = _mm512_i32gather_epi64(_mm256_loadu_si256((const __m256i *)&idx[i]), (const void *)locks, 8);
+    if (_mm512_cmpgt_epu64_mask(_mm512_srli_epi64(lw, VALIDATE_TS_SHIFT), endv))
+      break;
+  }
+  return i + validate_scalar_end(rs, first + i, n - i, end);
+}
+# else /* ! RW_SET_SOA */
+/* Entries are { version, lock } pairs: two 256-bit loads give four
+ * versions and four lock pointers after unpacking (in the same order),
+ * and the lock words are gathered from the pointers. */
+__attribute__((target("avx2")))
+static int validate_avx2_versions(r_set_t *rs, int first, int n)
+{
+  __m256i e0, e1, ver, lw, bad;
+  const __m256i owned = _mm256_set1_epi64x(OWNED_MASK);
+  r_entry_t *r = rs->entries + first;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    e0 = _mm256_loadu_si256((const __m256i *)&r[i]);
+    e1 = _mm256_loadu_si256((const __m256i *)&r[i + 2]);
+    ver = _mm256_unpacklo_epi64(e0, e1);
+    lw = _mm256_i64gather_epi64((const long long *)0, _mm256_unpackhi_epi64(e0, e1), 1);
+    bad = _mm256_or_si256(_mm256_xor_si256(_mm256_srli_epi64(lw, VALIDATE_TS_SHIFT), ver),
+                          _mm256_and_si256(lw, owned));
+    if (!_mm256_testz_si256(bad, bad))
+      break;
+  }
+  return i + validate_scalar_versions(rs, first + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int validate_avx2_end(r_set_t *rs, int first, int n, stm_word_t end)
+{
+  __m256i e0, e1, lw, gt;
+  const __m256i endv = _mm256_set1_epi64x(end);
+  r_entry_t *r = rs->entries + first;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    e0 = _mm256_loadu_si256((const __m256i *)&r[i]);
+    e1 = _mm256_loadu_si256((const __m256i *)&r[i + 2]);
+    lw = _mm256_i64gather_epi64((const long long *)0, _mm256_unpackhi_epi64(e0, e1), 1);
+    /* Shifted timestamps are positive: signed compare is fine */
+    gt = _mm256_cmpgt_epi64(_mm256_srli_epi64(lw, VALIDATE_TS_SHIFT), endv);
+    if (!_mm256_testz_si256(gt, gt))
+      break;
+  }
+  return i + validate_scalar_end(rs, first + i, n - i, end);
+}
+
+__attribute__((target("avx512f")))
+static int validate_avx512_versions(r_set_t *rs, int first, int n)
+{
+  __m512i e0, e1, ver, lw;
+  const __m512i even = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+  const __m512i odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  const __m512i owned = _mm512_set1_epi64(OWNED_MASK);
+  r_entry_t *r = rs->entries + first;
+  int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    e0 = _mm512_loadu_si512((const void *)&r[i]);
+    e1 = _mm512_loadu_si512((const void *)&r[i + 4]);
+    ver = _mm512_permutex2var_epi64(e0, even, e1);
+    lw = _mm512_i64gather_epi64(_mm512_permutex2var_epi64(e0, odd, e1), (const void *)0, 1);
+    if (_mm512_test_epi64_mask(lw, owned)
+        || _mm512_cmpneq_epu64_mask(_mm512_srli_epi64(lw, VALIDATE_TS_SHIFT), ver))
+      break;
+  }
+  return i + validate_scalar_versions(rs, first + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static int validate_avx512_end(r_set_t *rs, int first, int n, stm_word_t end)
+{
+  __m512i e0, e1, lw;
+  const __m512i odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  const __m512i endv = _mm512_set1_epi64(end);
+  r_entry_t *r = rs->entries + first;
+  int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    e0 = _mm512_loadu_si512((const void *)&r[i]);
+    e1 = _mm512_loadu_si512((const void *)&r[i + 4]);
+    lw = _mm512_i64gather_epi64(_mm512_permutex2var_epi64(e0, odd, e1), (const void *)0, 1);
+    if (_mm512_cmpgt_epu64_mask(_mm512_srli_epi64(lw, VALIDATE_TS_SHIFT), endv))
+      break;
+  }
+  return i + validate_scalar_end(rs, first + i, n - i, end);
+}
+# endif /* ! RW_SET_SOA */
+#endif /* SIMD_VALIDATION */
+
+static int validate_kernel = VALIDATE_SCALAR;
+static int (*validate_versions)(r_set_t *, int, int) = validate_scalar_versions;
+static int (*validate_end)(r_set_t *, int, int, stm_word_t) = validate_scalar_end;
+
+/*
+ * Select a validation kernel.  Returns 0 if not supported by the CPU.
+ */
+static int validate_set_kernel(int kernel)
+{
+  switch (kernel) {
+   case VALIDATE_SCALAR:
+     validate_versions = validate_scalar_versions;
+     validate_end = validate_scalar_end;
+     break;
+#ifdef SIMD_VALIDATION
+   case VALIDATE_AVX2:
+     if (!__builtin_cpu_supports("avx2"))
+       return 0;
+     validate_versions = validate_avx2_versions;
+     validate_end = validate_avx2_end;
+     break;
+   case VALIDATE_AVX512:
+     if (!__builtin_cpu_supports("avx512f"))
+       return 0;
+     validate_versions = validate_avx512_versions;
+     validate_end = validate_avx512_end;
+     break;
+#endif /* SIMD_VALIDATION */
+   default:
+     return 0;
+  }
+  validate_kernel = kernel;
+  return 1;
+}
+
+/*
+ * Pick the widest kernel supported by the CPU.
+ */
+static void validate_init()
+{
+#ifdef SIMD_VALIDATION
+  __builtin_cpu_init();
+  if (validate_set_kernel(VALIDATE_AVX512))
+    return;
+  if (validate_set_kernel(VALIDATE_AVX2))
+    return;
+#endif /* SIMD_VALIDATION */
+  validate_set_kernel(VALIDATE_SCALAR);
+}
+
 #ifdef SUPPORTER_THREAD
 /*
  * Validate read set (check if all read addresses are still valid now).
  */
-static inline int _stm_validate(stm_tx_t *tx)
+static inline int _stm_validate_range(stm_tx_t *tx, r_set_t *rs, int first, int i, stm_word_t end)
 {
-
-	r_entry_t *r;
-	int i;
+	int n;
+#if DESIGN != WRITE_BACK_CTL
+	int k;
 	stm_word_t l;
+#endif /* DESIGN != WRITE_BACK_CTL */
 
-	PRINT_DEBUG("==> stm_validate(%p[%lu-%lu])\n", tx, (unsigned long)tx->start, (unsigned long)tx->end);
-
-	/* Validate reads */
-	i = tx->r_set.nb_entries;
-	r = tx->r_set.entries;
-	for (; i > 0; i--, r++) {
+	/* Validate reads (by blocks, to stop early if the transaction ends) */
+	while (i > 0) {
 		if (!tx->running_transaction) return 1;
-		/* Read lock */
-		l = ATOMIC_LOAD(r->lock);
-		/* Unlocked and still the same version? */
-		//if (LOCK_GET_OWNED(l)) {
-		if (0) {
-
-#ifdef CONFLICT_TRACKING
-			if (conflict_cb != NULL && l != LOCK_UNIT) {
-				/* Call conflict callback */
-				stm_tx_t *other = ((w_entry_t *)LOCK_GET_ADDR(l))->tx;
-				conflict_cb(tx, other);
-			}
-#endif /* CONFLICT_TRACKING */
+		n = (i < VALIDATE_BLOCK ? i : VALIDATE_BLOCK);
+		/* Owned locks have a (large) address in place of the timestamp */
+#if DESIGN == WRITE_BACK_CTL
+		if (validate_end(rs, first, n, end) < n) {
+			/* Other version: cannot validate */
 			return 0;
-		} else {
-			//************************************
-			//int v=LOCK_GET_TIMESTAMP(l);
-			//int k=r->version;
-			//if(tot-i==0) {
-				//printf("\n\ttot %i posto %i dataitem % i version % i - timestamp %i clock %i",tot,tot-i,l, k,v, GET_CLOCK);
-				//fflush(stdout);
-			//}
-			//************************************
-			if (LOCK_GET_TIMESTAMP(l) > tx->end) {
+		}
+#else /* DESIGN != WRITE_BACK_CTL */
+		if ((k = validate_end(rs, first, n, end)) < n) {
+			/* Locks acquired upon write by the transaction itself keep the version it read */
+			l = ATOMIC_LOAD(RS_LOCK(rs, first + k));
+			if (!LOCK_GET_OWNED(l) || l == LOCK_UNIT
+# if DESIGN == WRITE_THROUGH
+			    || (stm_tx_t *)LOCK_GET_ADDR(l) != tx
+# else /* DESIGN == WRITE_BACK_ETL */
+			    || (w_entry_t *)LOCK_GET_ADDR(l) < tx->w_set.entries
+			    || (w_entry_t *)LOCK_GET_ADDR(l) >= tx->w_set.entries + tx->w_set.size
+# endif /* DESIGN == WRITE_BACK_ETL */
+			    ) {
 				/* Other version: cannot validate */
 				return 0;
 			}
-			/* Same version: OK */
+			n = k + 1;
 		}
+#endif /* DESIGN != WRITE_BACK_CTL */
+		first += n;
+		i -= n;
 	}
-	//printf("\n--------------------------------------");
 	return 1;
 }
+
+static inline int _stm_validate(stm_tx_t *tx)
+{
+	PRINT_DEBUG("==> stm_validate(%p[%lu-%lu])\n", tx, (unsigned long)tx->start, (unsigned long)tx->end);
+
+	return _stm_validate_range(tx, &tx->r_set, 0, tx->r_set.nb_entries, tx->end);
+}
 #endif
 
 static inline void print_readset(stm_tx_t *tx) {
 
-	r_entry_t *r;
 	int i;
 	stm_word_t l;
 
 	i = tx->r_set.nb_entries;
 	int tot=i;
-	r = tx->r_set.entries;
-	for (; i > 0; i--, r++) {
+	for (; i > 0; i--) {
 		/* Read lock */
-		l = ATOMIC_LOAD(r->lock);
+		l = ATOMIC_LOAD(RS_LOCK(&tx->r_set, tot-i));
 		int v = LOCK_GET_TIMESTAMP(l);
-		int k = r->version;
+		int k = RS_VERSION(&tx->r_set, tot-i);
 		printf("\n\t\t\t\ttot %i position, %i order %i, version % i, timestamp %i",tot, tot-i,l, k,v);
 		fflush(stdout);
 	}
@@ -1001,17 +2586,20 @@ static inline void print_readset(stm_tx_t *tx) {
  */
 static inline int stm_validate(stm_tx_t *tx)
 {
-  r_entry_t *r;
-  int i;
+  int i, n;
   stm_word_t l;
 
   PRINT_DEBUG("==> stm_validate(%p[%lu-%lu])\n", tx, (unsigned long)tx->start, (unsigned long)tx->end);
 
   /* Validate reads */
-  r = tx->r_set.entries;
-  for (i = tx->r_set.nb_entries; i > 0; i--, r++) {
+  n = tx->r_set.nb_entries;
+  for (i = 0; i < n; i++) {
+    /* Skip entries that are unlocked and still have the same version */
+    i += validate_versions(&tx->r_set, i, n - i);
+    if (i == n)
+      break;
     /* Read lock */
-    l = ATOMIC_LOAD(r->lock);
+    l = ATOMIC_LOAD(RS_LOCK(&tx->r_set, i));
     /* Unlocked and still the same version? */
     if (LOCK_GET_OWNED(l)) {
       /* Do we own the lock? */
@@ -1039,13 +2627,13 @@ static inline int stm_validate(stm_tx_t *tx)
       }
       /* We own the lock: OK */
 #if DESIGN == WRITE_BACK_CTL
-      if (w->version != r->version) {
+      if (w->version != RS_VERSION(&tx->r_set, i)) {
         /* Other version: cannot validate */
         return 0;
       }
 #endif /* DESIGN == WRITE_BACK_CTL */
     } else {
-      if (LOCK_GET_TIMESTAMP(l) != r->version) {
+      if (LOCK_GET_TIMESTAMP(l) != RS_VERSION(&tx->r_set, i)) {
         /* Other version: cannot validate */
         return 0;
       }
@@ -1074,6 +2662,9 @@ static inline int stm_extend(stm_tx_t *tx)
   if (stm_validate(tx)) {
     /* It works: we can extend until now */
     tx->end = now;
+#ifdef SUPPORTER_THREAD
+    tx->self_extended++;
+#endif /* SUPPORTER_THREAD */
     return 1;
   }
   return 0;
@@ -1084,6 +2675,18 @@ static inline int stm_extend(stm_tx_t *tx)
  */
 static inline void stm_prepare(stm_tx_t *tx)
 {
+#ifdef SUPPORTER_THREAD
+  stm_word_t reset;
+#endif /* SUPPORTER_THREAD */
+
+#ifdef MULTI_VERSION
+  /* Read-only transactions read their start snapshot (register before
+   * reading the clock, see mv_keep()) */
+  if (tx->ro && !tx->mv_fallback) {
+    tx->mv_snapshot = 1;
+    ATOMIC_FETCH_INC_FULL(&mv_active);
+  }
+#endif /* MULTI_VERSION */
 
  start:
   /* Start timestamp */
@@ -1098,14 +2701,14 @@ static inline void stm_prepare(stm_tx_t *tx)
   }
 
   /* Read/write set */
+  stm_ws_reset(&tx->w_set);
+  stm_rs_reset(&tx->r_set);
 
-  tx->w_set.nb_acquired = 0;
-# ifdef USE_BLOOM_FILTER
-  tx->w_set.bloom = 0;
-# endif /* USE_BLOOM_FILTER */
-
-  tx->w_set.nb_entries = 0;
-  tx->r_set.nb_entries = 0;
+#if CM == CM_MODULAR
+  /* Priority of the timestamp policy (kept upon restart) */
+  if (tx->retries == 0)
+    tx->cm_ts = tx->start;
+#endif /* CM == CM_MODULAR */
 
 #ifdef EPOCH_GC
   gc_set_epoch(tx->start);
@@ -1126,52 +2729,643 @@ static inline void stm_prepare(stm_tx_t *tx)
   stm_check_quiesce(tx);
 
 #ifdef SUPPORTER_THREAD
-  tx->current_run_checked=0;
   tx->total_prepares++;
-
-  //printf("\n\t\t\treset -  %i", GET_CLOCK);
-  tx->should_abort=0;
+# ifdef SUPPORTER_RO_ASSIST
+  /* Read-only transactions log their reads only while a supporter can extend them */
+  tx->ro_logged = (tx->ro && tx->group != NULL && tx->group->active > 0);
+#  ifdef MULTI_VERSION
+  /* Snapshots need no validation */
+  if (tx->mv_snapshot)
+    tx->ro_logged = 0;
+#  endif /* MULTI_VERSION */
+# endif /* SUPPORTER_RO_ASSIST */
+
+  /* Older verdicts no longer apply (start, end and read set are reset) */
+  ATOMIC_STORE_REL(&tx->attempt, tx->attempt + 1);
+  if ((reset = verdict_reset(tx->attempt)) != 0) {
+    /* The tag wraps around: once in-flight validations (of older attempts)
+     * are over, overwrite their verdict.  This is the only store of the
+     * worker to its mailbox. */
+    ATOMIC_MB_FULL;
+    while (ATOMIC_LOAD_ACQ(&tx->mailbox.validator) != 0)
+      __asm volatile ("pause" ::: "memory");
+    ATOMIC_STORE_REL(&tx->mailbox.verdict, reset);
+  }
+# ifdef SUPPORTER_DOOM_SIGNAL
+  tx->async_abort=0;
+# endif /* SUPPORTER_DOOM_SIGNAL */
+# ifdef SUPPORTER_COMMIT_LOG
+  memset(tx->r_sig, 0, sizeof(tx->r_sig));
+# endif /* SUPPORTER_COMMIT_LOG */
   tx->running_transaction=1;
 #endif /* ! SUPPORTER_THREAD */
 
 }
 
+#ifdef SUPPORTER_THREAD
 /*
- * Rollback transaction.
+ * Bucket of the latency histograms for a number of timer ticks.
  */
-static inline void stm_rollback(stm_tx_t *tx, int reason)
+static inline int supporter_latency_bucket(stm_time_t t)
 {
-  w_entry_t *w;
-
-
+	int b = 0;
 
-  PRINT_DEBUG("==> stm_rollback(%p[%lu-%lu])\n", tx, (unsigned long)tx->start, (unsigned long)tx->end);
-
-#ifdef SUPPORTER_THREAD
-  tx->total_aborts++;
-  tx->aborted=1;
-  tx->running_transaction=0;
-#endif /* ! SUPPORTER_THREAD */
+	while (t > 1 && b < SUPPORTER_LATENCY_BUCKETS - 1) {
+		t >>= 1;
+		b++;
+	}
+	return b;
+}
 
-  assert(IS_ACTIVE(tx->status));
+/*
+ * Find the transaction owning a lock (NULL if unknown, e.g., for a unit
+ * store).  The write set of the owner can be reallocated at any time, so
+ * the entry encoded in the lock is never dereferenced: the registry is
+ * searched for the write set that contains it.  A stale answer only costs
+ * a sleep bounded by LOCK_PARK_TIMEOUT.
+ */
+static inline stm_tx_t *stm_lock_owner(stm_word_t l)
+{
+#if DESIGN == WRITE_THROUGH
+  return (l == LOCK_UNIT ? NULL : (stm_tx_t *)LOCK_GET_ADDR(l));
+#else /* DESIGN != WRITE_THROUGH */
+  w_entry_t *w, *e;
+  stm_tx_t *c;
+  int i, n;
 
-  if (tx->w_set.nb_acquired > 0) {
-    w = tx->w_set.entries + tx->w_set.nb_entries;
-    do {
-      w--;
-      if (!w->no_drop) {
-        if (--tx->w_set.nb_acquired == 0) {
-          /* Make sure that all lock releases become visible to other threads */
-          ATOMIC_STORE_REL(w->lock, LOCK_SET_TIMESTAMP(w->version));
-        } else {
-          ATOMIC_STORE(w->lock, LOCK_SET_TIMESTAMP(w->version));
-        }
-      }
-    } while (tx->w_set.nb_acquired > 0);
+  if (l == LOCK_UNIT)
+    return NULL;
+  w = (w_entry_t *)LOCK_GET_ADDR(l);
+  n = (int)stm_tx_slots_hwm;
+  for (i = 0; i < n; i++) {
+    if ((c = (stm_tx_t *)stm_tx_slots[i].tx) == NULL)
+      continue;
+    e = c->w_set.entries;
+    if (e <= w && w < e + c->w_set.size)
+      return c;
   }
+  return NULL;
+#endif /* DESIGN != WRITE_THROUGH */
+}
 
+/*
+ * Wait until a locked stripe changes (released or locked again).  Spin
+ * first, then yield the CPU: locks are only held while their owner
+ * commits, unless it has been preempted.  After LOCK_YIELD_BUDGET yields,
+ * either give up (returns 0, the caller aborts) or sleep until the owner
+ * releases its locks, so that oversubscribed waiters leave their CPU to
+ * it.  Waiters register in lock_waiters before checking the lock again,
+ * and owners check lock_waiters after a full barrier that follows their
+ * releases (see stm_wake_lock_waiters()): either the owner wakes up the
+ * waiter or the waiter sees the lock released.  Returns 1 once the lock
+ * has changed.
+ */
+static int stm_wait_lock(stm_tx_t *tx, volatile stm_word_t *lock, stm_word_t l, int policy)
+{
+  stm_tx_t *owner;
+#ifdef SUPPORTER_THREAD_TIMERS
+  stm_time_t start = STM_TIMER_READ();
+#endif /* SUPPORTER_THREAD_TIMERS */
+  long n;
+  int seq, ok = 1;
 
-#if CM == CM_MODULAR || defined(INTERNAL_STATS)
+  tx->lock_waits++;
+  for (n = 0; ATOMIC_LOAD_ACQ(lock) == l; n++) {
+    if (n < lock_spin_budget || policy == LOCK_WAIT_SPIN) {
+      __asm volatile ("pause" ::: "memory");
+      continue;
+    }
+    if (n < lock_spin_budget + LOCK_YIELD_BUDGET) {
+      sched_yield();
+      continue;
+    }
+    if (policy == LOCK_WAIT_ABORT) {
+      tx->lock_wait_aborts++;
+      ok = 0;
+      break;
+    }
+    if ((owner = stm_lock_owner(l)) == NULL || owner == tx) {
+      sched_yield();
+      continue;
+    }
+    seq = owner->release_seq;
+    ATOMIC_FETCH_INC_FULL(&owner->lock_waiters);
+    if (ATOMIC_LOAD_ACQ(lock) == l)
+      supporter_futex_wait(&owner->release_seq, seq, LOCK_PARK_TIMEOUT);
+    ATOMIC_FETCH_DEC_FULL(&owner->lock_waiters);
+    tx->lock_wait_parks++;
+  }
+#ifdef SUPPORTER_THREAD_TIMERS
+  tx->lock_wait_latency[supporter_latency_bucket(STM_TIMER_READ() - start)]++;
+#endif /* SUPPORTER_THREAD_TIMERS */
+
+  return ok;
+}
+
+/*
+ * Wake up the transactions sleeping on our locks, once they are released.
+ */
+static inline void stm_wake_lock_waiters(stm_tx_t *tx)
+{
+  ATOMIC_MB_FULL;
+  if (ATOMIC_LOAD(&tx->lock_waiters) > 0) {
+    tx->release_seq++;
+    supporter_futex_wake(&tx->release_seq);
+  }
+}
+#else /* ! SUPPORTER_THREAD */
+/*
+ * Spin on a locked stripe.
+ */
+static inline int stm_wait_lock(stm_tx_t *tx, volatile stm_word_t *lock, stm_word_t l, int policy)
+{
+  while (ATOMIC_LOAD_ACQ(lock) == l)
+    __asm volatile ("pause" ::: "memory");
+  return 1;
+}
+
+static inline void stm_wake_lock_waiters(stm_tx_t *tx)
+{
+}
+#endif /* ! SUPPORTER_THREAD */
+
+/*
+ * Install the new versions of a validated commit, drop its locks with
+ * its timestamp and wake up the transactions waiting for them.
+ */
+static inline void stm_write_back(stm_tx_t *tx, stm_word_t t)
+{
+  w_entry_t *w;
+  int i;
+#if DESIGN != WRITE_THROUGH
+  stm_word_t value;
+#endif /* DESIGN != WRITE_THROUGH */
+
+#ifdef MULTI_VERSION
+  /* Keep the overwritten values for the snapshots that started before
+   * (before dropping any lock, as the entries of a stripe may come after
+   * the one that releases it) */
+  w = tx->w_set.entries;
+  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
+    if (w->mask != 0) {
+# if DESIGN == WRITE_THROUGH
+      mv_keep(tx, w->lock, w->addr, w->value, t);
+# else /* DESIGN != WRITE_THROUGH */
+      mv_keep(tx, w->lock, w->addr, ATOMIC_LOAD(w->addr), t);
+# endif /* DESIGN != WRITE_THROUGH */
+    }
+  }
+#endif /* MULTI_VERSION */
+
+  /* Install new versions, drop locks and set new timestamp */
+  w = tx->w_set.entries;
+  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
+    /* TODO stm_release */
+    //if (w->addr == NULL)
+      //continue;
+#if DESIGN != WRITE_THROUGH
+    if (w->mask == ~(stm_word_t)0) {
+      ATOMIC_STORE(w->addr, w->value);
+    } else if (w->mask != 0) {
+      value = (ATOMIC_LOAD(w->addr) & ~w->mask) | (w->value & w->mask);
+      ATOMIC_STORE(w->addr, value);
+    }
+#endif /* DESIGN != WRITE_THROUGH */
+    /* Only drop lock for last covered address in write set (cannot be "no drop") */
+#if DESIGN == WRITE_BACK_ETL
+    if (w->next == NULL) {
+#else /* DESIGN != WRITE_BACK_ETL */
+    if (!w->no_drop) {
+#endif /* DESIGN != WRITE_BACK_ETL */
+      ATOMIC_STORE_REL(w->lock, LOCK_SET_TIMESTAMP(t));
+#ifdef SUPPORTER_COMMIT_LOG
+      /* Log released lock for the supporters */
+      tx->clog[tx->clog_head & (COMMIT_LOG_SIZE - 1)].idx = w->lock - locks;
+      tx->clog[tx->clog_head & (COMMIT_LOG_SIZE - 1)].ts = t;
+      ATOMIC_STORE_REL(&tx->clog_head, tx->clog_head + 1);
+#endif /* SUPPORTER_COMMIT_LOG */
+    }
+  }
+  stm_wake_lock_waiters(tx);
+}
+
+#ifdef GROUP_COMMIT
+/*
+ * Commit a transaction that holds all its locks together with the
+ * concurrent ones (flat combining).  The first of them to take the group
+ * increments the clock once for all the commits waiting, then validates
+ * and writes back each of them on behalf of its thread, which only waits
+ * for the outcome.  The commits of a batch hold disjoint locks, hence a
+ * commit that read a stripe written by another one fails validation as
+ * usual.  Returns whether the transaction has been written back (it still
+ * holds its locks otherwise).
+ */
+static int stm_group_commit(stm_tx_t *tx)
+{
+  stm_tx_t *m, *next;
+  stm_word_t head, t;
+  unsigned long size;
+  long n;
+  int ok;
+#ifdef SUPPORTER_COMMIT_LOG
+  unsigned long written;
+  stm_word_t pos;
+  int slot;
+#endif /* SUPPORTER_COMMIT_LOG */
+
+  ATOMIC_STORE(&tx->group_state, GROUP_PENDING);
+  do {
+    head = ATOMIC_LOAD(&commit_group.pending);
+    tx->group_next = (stm_tx_t *)head;
+  } while (ATOMIC_CAS_FULL(&commit_group.pending, head, (stm_word_t)tx) == 0);
+
+  for (n = 0; ATOMIC_LOAD_ACQ(&tx->group_state) == GROUP_PENDING; n++) {
+    if (ATOMIC_LOAD(&commit_group.busy) == 0 && ATOMIC_CAS_FULL(&commit_group.busy, 0, 1)) {
+      /* Take all the waiting commits (ours too, unless already served) */
+      do {
+        head = ATOMIC_LOAD(&commit_group.pending);
+      } while (head != 0 && ATOMIC_CAS_FULL(&commit_group.pending, head, 0) == 0);
+      if (head != 0) {
+        /* All of them hold their locks */
+        t = FETCH_INC_CLOCK + 1;
+        size = 0;
+#ifdef SUPPORTER_COMMIT_LOG
+        written = 0;
+        pos = 0;
+        slot = COMMIT_LOG_NONE;
+#endif /* SUPPORTER_COMMIT_LOG */
+        for (m = (stm_tx_t *)head; m != NULL; m = next) {
+          /* Its thread may commit again as soon as it has its outcome */
+          next = m->group_next;
+          ok = ((stm_tx_t *)head == m && next == NULL && CLOCK_EXCLUSIVE(m, t)) || stm_validate(m);
+          if (ok) {
+            stm_write_back(m, t);
+#ifdef SUPPORTER_COMMIT_LOG
+            /* Read before its thread can commit again */
+            written++;
+            pos = m->clog_head;
+            slot = m->slot;
+#endif /* SUPPORTER_COMMIT_LOG */
+          }
+          ATOMIC_STORE_REL(&m->group_state, ok ? GROUP_COMMITTED : GROUP_ABORTED);
+          size++;
+        }
+#ifdef SUPPORTER_COMMIT_LOG
+        /* The index holds a single committer per timestamp: a batch with
+         * several write-backs is left without record */
+        if (written == 0 || (written == 1 && slot >= 0))
+          commit_log_publish(t, pos, written == 0 ? COMMIT_LOG_NONE : slot);
+#endif /* SUPPORTER_COMMIT_LOG */
+        tx->group_batches++;
+        tx->group_commits += size;
+      }
+      ATOMIC_STORE_REL(&commit_group.busy, 0);
+      n = 0;
+      continue;
+    }
+    /* The combiner only validates and writes back: no need to sleep */
+    if (n < lock_spin_budget)
+      __asm volatile ("pause" ::: "memory");
+    else
+      sched_yield();
+  }
+
+  return (ATOMIC_LOAD(&tx->group_state) == GROUP_COMMITTED);
+}
+#endif /* GROUP_COMMIT */
+
+#ifdef ATS
+/*
+ * Scheduling state of the atomic block of a transaction (identified by
+ * the attributes, as with mod_ab).
+ */
+static inline ats_block_t *ats_block_of(stm_tx_t *tx)
+{
+  return &ats_blocks[(unsigned int)tx->attr.id % ATS_BLOCKS];
+}
+
+/*
+ * Account for the outcome of an attempt in the contention intensity of
+ * its block.  Concurrent updates may be lost, which only makes the
+ * average approximate.
+ */
+static inline void ats_update(stm_tx_t *tx, int aborted)
+{
+  ats_block_t *b;
+  stm_word_t ci;
+
+  /* Untagged transactions are not an atomic block */
+  if (tx->attr.id == 0)
+    return;
+  b = ats_block_of(tx);
+  /* Round up so that the intensity reaches 0 (and ATS_ONE) */
+  ci = ATOMIC_LOAD(&b->intensity);
+  if (aborted)
+    ci += (ATS_ONE - ci + (1 << ATS_DECAY) - 1) >> ATS_DECAY;
+  else
+    ci -= (ci + (1 << ATS_DECAY) - 1) >> ATS_DECAY;
+  ATOMIC_STORE(&b->intensity, ci);
+}
+
+/*
+ * Wait for our turn behind the other instances of our atomic block if
+ * they conflict too often, instead of retrying blindly.  The turn is kept
+ * until commit, so a contended block runs one instance at a time until
+ * its intensity decays below the threshold.  We are not active and hold
+ * no lock, hence waiting cannot deadlock.  Waiters spin, yield, then
+ * sleep as with locked stripes.  Transactions without an id (0) are
+ * never queued.
+ */
+static void ats_schedule(stm_tx_t *tx)
+{
+  ats_block_t *b;
+  unsigned int ticket, seq;
+  long n;
+
+  if (tx->ats_block != NULL || ats_threshold <= 0 || tx->attr.id == 0)
+    return;
+# ifdef IRREVOCABLE_ENABLED
+  /* Irrevocable transactions run alone anyway */
+  if (tx->irrevocable != 0)
+    return;
+# endif /* IRREVOCABLE_ENABLED */
+  b = ats_block_of(tx);
+  if (ATOMIC_LOAD(&b->intensity) < (stm_word_t)ats_threshold)
+    return;
+  ticket = (unsigned int)ATOMIC_FETCH_INC_FULL(&b->next);
+  tx->ats_block = b;
+  tx->ats_queued++;
+  for (n = 0; (seq = b->serving) != ticket; n++) {
+    if (n < lock_spin_budget) {
+      __asm volatile ("pause" ::: "memory");
+      continue;
+    }
+    if (n < lock_spin_budget + LOCK_YIELD_BUDGET) {
+      sched_yield();
+      continue;
+    }
+    ATOMIC_FETCH_INC_FULL(&b->waiters);
+    if (b->serving == seq)
+      supporter_futex_wait((volatile int *)&b->serving, (int)seq, LOCK_PARK_TIMEOUT);
+    ATOMIC_FETCH_DEC_FULL(&b->waiters);
+  }
+  ATOMIC_MB_FULL;
+}
+
+/*
+ * Hand our turn over to the next instance of our atomic block.
+ */
+static inline void ats_release(stm_tx_t *tx)
+{
+  ats_block_t *b = tx->ats_block;
+
+  if (b == NULL)
+    return;
+  tx->ats_block = NULL;
+  ATOMIC_MB_FULL;
+  b->serving++;
+  ATOMIC_MB_FULL;
+  if (ATOMIC_LOAD(&b->waiters) > 0)
+    supporter_futex_wake((volatile int *)&b->serving);
+}
+#endif /* ATS */
+
+#if CM == CM_MODULAR
+/*
+ * Work done by a transaction (karma policy), including its aborted
+ * attempts.  The counters of another thread are read without
+ * synchronization, which only makes the decision approximate.
+ */
+static inline unsigned long stm_cm_karma(stm_tx_t *tx)
+{
+  return tx->cm_karma + tx->r_set.nb_entries + tx->w_set.nb_entries;
+}
+
+/*
+ * Decide what to do about a lock owned by another transaction (NULL if
+ * unknown).  Returns a combination of STM_CM_* flags.  The timestamp
+ * policy only lets transactions wait for younger ones, hence waits
+ * cannot form a cycle; karma changes while transactions run, hence its
+ * waits are only safe because they are bounded when the owner may be
+ * waiting too (see stm_cm_conflict()).
+ */
+static inline int stm_cm_decide(stm_tx_t *tx, stm_tx_t *owner, int reason)
+{
+  unsigned long k1, k2;
+
+  switch (cm_policy) {
+   case CM_POLICY_DELAY:
+   case CM_POLICY_SUPPORTER:
+     return STM_CM_DELAY;
+   case CM_POLICY_BACKOFF:
+     return STM_CM_BACKOFF;
+   case CM_POLICY_WAIT:
+     return STM_CM_WAIT | STM_CM_DELAY;
+   case CM_POLICY_TIMESTAMP:
+     if (owner != NULL && (tx->cm_ts < owner->cm_ts || (tx->cm_ts == owner->cm_ts && tx < owner)))
+       return STM_CM_WAIT | STM_CM_DELAY;
+     return STM_CM_DELAY;
+   case CM_POLICY_KARMA:
+     if (owner != NULL && ((k1 = stm_cm_karma(tx)) > (k2 = stm_cm_karma(owner)) || (k1 == k2 && tx < owner)))
+       return STM_CM_WAIT | STM_CM_DELAY;
+     return STM_CM_DELAY;
+   case CM_POLICY_CUSTOM:
+     return cm_function(tx, owner, reason);
+   default:
+     return STM_CM_ABORT;
+  }
+}
+#endif /* CM == CM_MODULAR */
+
+/*
+ * Resolve a conflict on a stripe locked by another transaction.  Without
+ * CM_MODULAR, only locks that cannot be held by a waiting transaction
+ * (commit-time locks seen during execution) are waited for.  Waits are
+ * bounded when the owner may be waiting for us (encounter-time locks,
+ * or locks acquired upon commit).  Returns 1 if the lock has changed, 0
+ * if the transaction must abort.
+ */
+static inline int stm_cm_conflict(stm_tx_t *tx, volatile stm_word_t *lock, stm_word_t l, int reason, int bounded)
+{
+#if CM == CM_MODULAR
+  int d;
+
+  d = stm_cm_decide(tx, stm_lock_owner(l), reason);
+  if ((d & STM_CM_WAIT) != 0 && stm_wait_lock(tx, lock, l, bounded ? LOCK_WAIT_ABORT : lock_wait_policy))
+    return 1;
+  tx->cm_flags = d & (STM_CM_DELAY | STM_CM_BACKOFF);
+#else /* CM != CM_MODULAR */
+  if (!bounded && stm_wait_lock(tx, lock, l, lock_wait_policy))
+    return 1;
+#endif /* CM != CM_MODULAR */
+#if CM == CM_DELAY || CM == CM_MODULAR
+  tx->c_lock = lock;
+#endif /* CM == CM_DELAY || CM == CM_MODULAR */
+  return 0;
+}
+
+#if CM == CM_DELAY || CM == CM_MODULAR
+/*
+ * Take the advice of the supporter that doomed the transaction: the
+ * stripe whose new version invalidated the read set (index + 1, 0 if
+ * unknown).  The transaction restarts once the stripe is unlocked and,
+ * with the supporter policy, backs off while the same stripe keeps
+ * dooming it.
+ */
+static inline void stm_cm_doomed(stm_tx_t *tx, stm_word_t stripe)
+{
+  if (stripe == 0)
+    return;
+# if CM == CM_MODULAR
+  if (cm_policy != CM_POLICY_SUPPORTER)
+    return;
+  tx->cm_flags = STM_CM_DELAY | (locks + (stripe - 1) == tx->cm_doom_lock ? STM_CM_BACKOFF : 0);
+  tx->cm_doom_lock = locks + (stripe - 1);
+# endif /* CM == CM_MODULAR */
+  tx->c_lock = locks + (stripe - 1);
+}
+
+/*
+ * Wait until the lock that caused the abort is released.  We hold no
+ * lock any more, hence the wait cannot deadlock.
+ */
+static inline void stm_cm_delay(stm_tx_t *tx)
+{
+  stm_word_t l;
+
+  if (tx->c_lock == NULL)
+    return;
+  while (LOCK_GET_OWNED(l = ATOMIC_LOAD_ACQ(tx->c_lock)))
+    stm_wait_lock(tx, tx->c_lock, l, lock_wait_policy);
+  tx->c_lock = NULL;
+}
+#endif /* CM == CM_DELAY || CM == CM_MODULAR */
+
+#if CM == CM_BACKOFF || CM == CM_MODULAR
+/*
+ * Wait for a random delay whose range doubles with every consecutive
+ * abort (up to MAX_BACKOFF).
+ */
+static inline void stm_cm_backoff(stm_tx_t *tx)
+{
+  unsigned long wait, j;
+
+  /* Simple RNG (good enough for backoff) */
+  tx->seed ^= (tx->seed << 17);
+  tx->seed ^= (tx->seed >> 13);
+  tx->seed ^= (tx->seed << 5);
+  wait = tx->seed % tx->backoff;
+  for (j = 0; j < wait; j++)
+    __asm volatile ("pause" ::: "memory");
+  if (tx->backoff < MAX_BACKOFF)
+    tx->backoff <<= 1;
+}
+#endif /* CM == CM_BACKOFF || CM == CM_MODULAR */
+
+/*
+ * Let the contention manager delay the restart of an aborted transaction.
+ */
+static inline void stm_cm_restart(stm_tx_t *tx)
+{
+#if CM == CM_MODULAR
+  int flags = tx->cm_flags;
+
+  tx->cm_flags = 0;
+  tx->cm_karma += tx->r_set.nb_entries + tx->w_set.nb_entries;
+  if ((flags & STM_CM_DELAY) != 0)
+    stm_cm_delay(tx);
+  tx->c_lock = NULL;
+  if ((flags & STM_CM_BACKOFF) != 0)
+    stm_cm_backoff(tx);
+#elif CM == CM_DELAY
+  stm_cm_delay(tx);
+#elif CM == CM_BACKOFF
+  stm_cm_backoff(tx);
+#endif /* CM == CM_BACKOFF */
+}
+
+/*
+ * Rollback transaction.
+ */
+static inline void stm_rollback(stm_tx_t *tx, int reason)
+{
+  w_entry_t *w;
+#if DESIGN == WRITE_BACK_ETL
+  int i;
+#elif DESIGN == WRITE_THROUGH
+  stm_word_t t, i;
+#endif /* DESIGN == WRITE_THROUGH */
+
+
+  PRINT_DEBUG("==> stm_rollback(%p[%lu-%lu])\n", tx, (unsigned long)tx->start, (unsigned long)tx->end);
+
+#ifdef SUPPORTER_THREAD
+  tx->total_aborts++;
+  tx->aborted=1;
+  tx->running_transaction=0;
+#endif /* ! SUPPORTER_THREAD */
+
+  assert(IS_ACTIVE(tx->status));
+
+#if DESIGN == WRITE_BACK_ETL
+  /* Drop locks (only once per lock: the last entry of each chain) */
+  w = tx->w_set.entries;
+  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
+    if (w->next == NULL)
+      ATOMIC_STORE(w->lock, LOCK_SET_TIMESTAMP(w->version));
+  }
+  /* Make sure that all lock releases become visible to other threads */
+  ATOMIC_MB_WRITE;
+#elif DESIGN == WRITE_THROUGH
+  t = 0;
+  /* Undo writes and drop locks (traverse in reverse order) */
+  w = tx->w_set.entries + tx->w_set.nb_entries;
+  while (w != tx->w_set.entries) {
+    w--;
+    if (w->mask != 0)
+      ATOMIC_STORE(w->addr, w->value);
+    if (w->no_drop)
+      continue;
+    /* Incarnation numbers allow readers to detect dirty reads */
+    i = LOCK_GET_INCARNATION(w->version) + 1;
+    if (i > INCARNATION_MAX) {
+      /* Simple approach: write new version (might trigger unnecessary aborts) */
+      if (t == 0)
+        t = clock_commit(tx);
+      ATOMIC_STORE(w->lock, LOCK_SET_TIMESTAMP(t));
+    } else {
+      ATOMIC_STORE(w->lock, LOCK_UPD_INCARNATION(w->version, i));
+    }
+  }
+  /* Make sure that all lock releases become visible to other threads */
+  ATOMIC_MB_WRITE;
+#else /* DESIGN == WRITE_BACK_CTL */
+  if (tx->w_set.nb_acquired > 0) {
+    w = tx->w_set.entries + tx->w_set.nb_entries;
+    do {
+      w--;
+      if (!w->no_drop) {
+        if (--tx->w_set.nb_acquired == 0) {
+          /* Make sure that all lock releases become visible to other threads */
+          ATOMIC_STORE_REL(w->lock, LOCK_SET_TIMESTAMP(w->version));
+        } else {
+          ATOMIC_STORE(w->lock, LOCK_SET_TIMESTAMP(w->version));
+        }
+      }
+    } while (tx->w_set.nb_acquired > 0);
+    stm_wake_lock_waiters(tx);
+  }
+#endif /* DESIGN == WRITE_BACK_CTL */
+#if DESIGN != WRITE_BACK_CTL
+  stm_wake_lock_waiters(tx);
+#endif /* DESIGN != WRITE_BACK_CTL */
+
+
+#ifdef MULTI_VERSION
+  mv_end(tx);
+#endif /* MULTI_VERSION */
+
+#if CM == CM_MODULAR || defined(INTERNAL_STATS)
   tx->retries++;
 #endif /* CM == CM_MODULAR || defined(INTERNAL_STATS) */
 #ifdef INTERNAL_STATS
@@ -1198,13 +3392,26 @@ static inline void stm_rollback(stm_tx_t *tx, int reason)
   }
 
 
+#ifdef ATS
+  ats_update(tx, 1);
+#endif /* ATS */
+
   /* TODO: what is the expected behavior of STM_ABORT_EXPLICIT? */
   /* Don't prepare a new transaction if no retry. */
   if (tx->attr.no_retry || (reason & STM_ABORT_EXPLICIT) != 0) {
+#ifdef ATS
+    ats_release(tx);
+#endif /* ATS */
     tx->nesting = 0;
     return;
   }
 
+  /* Contention management */
+  stm_cm_restart(tx);
+#ifdef ATS
+  ats_schedule(tx);
+#endif /* ATS */
+
   /* Reset field to restart transaction */
   stm_prepare(tx);
 
@@ -1228,28 +3435,93 @@ static inline void stm_rollback(stm_tx_t *tx, int reason)
 #endif /* !defined(TM_DTMC) && !defined(TM_GCC) && !defined (TM_INTEL) */
 }
 
+#ifdef MULTI_VERSION
 /*
- * Load a word-sized value (invisible read).
+ * Load a word-sized value as of the start of a snapshot transaction:
+ * from memory if it has not been overwritten since, otherwise from the
+ * old versions of the stripe.  The version current at the start is the
+ * one that was overwritten first after the start, provided no version of
+ * the stripe has been forgotten since.  Nothing is added to the read set,
+ * hence the transaction commits without validation.
  */
-static inline stm_word_t stm_read_invisible(stm_tx_t *tx, volatile stm_word_t *addr)
+static stm_word_t stm_mv_read(stm_tx_t *tx, volatile stm_word_t *addr)
 {
   volatile stm_word_t *lock;
-  stm_word_t l, l2, value, version;
-  r_entry_t *r;
-  w_entry_t *written = NULL;
-
-
-  PRINT_DEBUG2("==> stm_read_invisible(t=%p[%lu-%lu],a=%p)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, addr);
-
-#if CM != CM_MODULAR
-  assert(IS_ACTIVE(tx->status));
-#endif /* CM != CM_MODULAR */
+  mv_chain_t *c;
+  mv_version_t *v, *found;
+  stm_word_t l, l2, value = 0;
 
-#if DESIGN == WRITE_BACK_CTL
-  /* Did we previously write the same address? */
-  written = stm_has_written(tx, addr);
-  if (written != NULL) {
-    /* Yes: get value from write set if possible */
+  lock = GET_LOCK(addr);
+  c = &mv_chains[lock - locks];
+ restart:
+  l = ATOMIC_LOAD_ACQ(lock);
+  if (!LOCK_GET_OWNED(l)) {
+    value = ATOMIC_LOAD_ACQ(addr);
+    l2 = ATOMIC_LOAD_ACQ(lock);
+    if (l != l2)
+      goto restart;
+    if (LOCK_GET_TIMESTAMP(l) <= tx->start)
+      return value;
+  }
+  /* Newer version of the stripe (or locked): look for an old version */
+  found = NULL;
+  v = (mv_version_t *)ATOMIC_LOAD_ACQ(&c->head);
+  for (; v != NULL && v->until > tx->start; v = (mv_version_t *)ATOMIC_LOAD_ACQ(&v->next)) {
+    if (v->addr == addr)
+      found = v;
+  }
+  if (ATOMIC_LOAD_ACQ(&c->forgotten) <= tx->start) {
+    if (found != NULL) {
+      tx->mv_reads++;
+      return found->value;
+    }
+    /* Not overwritten since the start (another word of the stripe was) */
+    if (!LOCK_GET_OWNED(l))
+      return value;
+    /* Being overwritten: wait for the owner to keep the old version */
+    if (stm_wait_lock(tx, lock, l, lock_wait_policy))
+      goto restart;
+    stm_rollback(tx, STM_ABORT_RW_CONFLICT);
+    return 0;
+  }
+  /* The version has been forgotten: read the latest versions on retry */
+  tx->mv_misses++;
+  tx->mv_fallback = 1;
+  stm_rollback(tx, STM_ABORT_VAL_READ);
+  return 0;
+}
+#endif /* MULTI_VERSION */
+
+/*
+ * Load a word-sized value (invisible read).
+ */
+static inline stm_word_t stm_read_invisible(stm_tx_t *tx, volatile stm_word_t *addr)
+{
+  volatile stm_word_t *lock;
+  stm_word_t l, l2, value, version;
+#if DESIGN == WRITE_BACK_CTL
+  w_entry_t *written = NULL;
+#elif DESIGN == WRITE_BACK_ETL
+  w_entry_t *w;
+#endif /* DESIGN == WRITE_BACK_ETL */
+
+
+  PRINT_DEBUG2("==> stm_read_invisible(t=%p[%lu-%lu],a=%p)\n", tx, (unsigned long)tx->start, (unsigned long)tx->end, addr);
+
+#if CM != CM_MODULAR
+  assert(IS_ACTIVE(tx->status));
+#endif /* CM != CM_MODULAR */
+
+#ifdef MULTI_VERSION
+  if (tx->mv_snapshot)
+    return stm_mv_read(tx, addr);
+#endif /* MULTI_VERSION */
+
+#if DESIGN == WRITE_BACK_CTL
+  /* Did we previously write the same address? */
+  written = stm_has_written(tx, addr);
+  if (written != NULL) {
+    /* Yes: get value from write set if possible */
     if (written->mask == ~(stm_word_t)0) {
       value = written->value;
       /* No need to add to read set */
@@ -1271,13 +3543,48 @@ static inline stm_word_t stm_read_invisible(stm_tx_t *tx, volatile stm_word_t *a
     /* Locked */
     if (l == LOCK_UNIT) {
       /* Data modified by a unit store: should not last long => retry */
-      goto restart;
+      if (stm_wait_lock(tx, lock, l, lock_wait_policy))
+        goto restart;
     }
+#if DESIGN == WRITE_BACK_CTL
+    /* Only held during commit: wait for the owner (see stm_cm_conflict()) */
+    else if (stm_cm_conflict(tx, lock, l, STM_ABORT_RW_CONFLICT, 0))
+      goto restart;
+    /* Waited too long */
+# ifdef INTERNAL_STATS
+    tx->aborts_locked_read++;
+# endif /* INTERNAL_STATS */
+    stm_rollback(tx, STM_ABORT_RW_CONFLICT);
+    return 0;
+#else /* DESIGN != WRITE_BACK_CTL */
     /* Do we own the lock? */
-
-    /* Spin while locked (should not last long) */
-    goto restart;
-
+# if DESIGN == WRITE_THROUGH
+    if (tx == (stm_tx_t *)LOCK_GET_ADDR(l)) {
+      /* Yes: memory holds our writes (no need to add to read set) */
+      return ATOMIC_LOAD_ACQ(addr);
+    }
+# else /* DESIGN == WRITE_BACK_ETL */
+    w = (w_entry_t *)LOCK_GET_ADDR(l);
+    /* Simply check if address falls inside our write set (avoids non-faulting load) */
+    if (tx->w_set.entries <= w && w < tx->w_set.entries + tx->w_set.nb_entries) {
+      /* Yes: did we previously write the same address? */
+      for (; w != NULL; w = w->next) {
+        if (w->addr == addr && w->mask != 0)
+          return w->value;
+      }
+      /* No: memory cannot change while we own the lock (no need to add to read set) */
+      return ATOMIC_LOAD_ACQ(addr);
+    }
+# endif /* DESIGN == WRITE_BACK_ETL */
+    /* Locked by another transaction until it commits: the owner may wait for us */
+    if (l != LOCK_UNIT && stm_cm_conflict(tx, lock, l, STM_ABORT_RW_CONFLICT, 1))
+      goto restart;
+# ifdef INTERNAL_STATS
+    tx->aborts_locked_read++;
+# endif /* INTERNAL_STATS */
+    stm_rollback(tx, STM_ABORT_RW_CONFLICT);
+    return 0;
+#endif /* DESIGN != WRITE_BACK_CTL */
   } else {
     /* Not locked */
     value = ATOMIC_LOAD_ACQ(addr);
@@ -1300,8 +3607,14 @@ static inline stm_word_t stm_read_invisible(stm_tx_t *tx, volatile stm_word_t *a
 #ifdef IRREVOCABLE_ENABLED
       assert(!tx->irrevocable);
 #endif /* IRREVOCABLE_ENABLED */
+      /* The version may be ahead of the clock (lazy clock schemes) */
+      clock_advance(version);
       /* No: try to extend first (except for read-only transactions: no read set) */
+#ifdef SUPPORTER_THREAD
+      if ((tx->ro && !tx->ro_logged) || !tx->can_extend || !stm_extend(tx)) {
+#else /* ! SUPPORTER_THREAD */
       if (tx->ro || !tx->can_extend || !stm_extend(tx)) {
+#endif /* ! SUPPORTER_THREAD */
         /* Not much we can do: abort */
 
 #ifdef INTERNAL_STATS
@@ -1334,24 +3647,31 @@ static inline stm_word_t stm_read_invisible(stm_tx_t *tx, volatile stm_word_t *a
 #ifdef READ_LOCKED_DATA
  add_to_read_set:
 #endif /* READ_LOCKED_DATA */
+#ifdef SUPPORTER_THREAD
+  if (!tx->ro || tx->ro_logged) {
+#else /* ! SUPPORTER_THREAD */
   if (!tx->ro) {
+#endif /* ! SUPPORTER_THREAD */
 #ifdef NO_DUPLICATES_IN_RW_SETS
-    if (stm_has_read(tx, lock) != NULL)
+    if (stm_has_read(tx, lock))
       return value;
 #endif /* NO_DUPLICATES_IN_RW_SETS */
     /* Add address and version to read set */
     if (tx->r_set.nb_entries == tx->r_set.size)
       stm_allocate_rs_entries(tx, 1);
 #ifdef SUPPORTER_THREAD
-    r = &tx->r_set.entries[tx->r_set.nb_entries];
-    r->version = version;
-    r->lock = lock;
+    RS_SET(&tx->r_set, tx->r_set.nb_entries, lock, version);
+# ifdef SUPPORTER_COMMIT_LOG
+    tx->r_sig[READ_SIG_WORD(lock - locks)] |= READ_SIG_MASK(lock - locks);
+# endif /* SUPPORTER_COMMIT_LOG */
     tx->r_set.nb_entries++;
 #else
-  r = &tx->r_set.entries[tx->r_set.nb_entries++];
-  r->version = version;
-  r->lock = lock;
+    RS_SET(&tx->r_set, tx->r_set.nb_entries, lock, version);
+    tx->r_set.nb_entries++;
 #endif /* ! SUPPORTER_THREAD */
+#ifdef READ_SET_INDEX
+    stm_rs_index_add(&tx->r_set);
+#endif /* READ_SET_INDEX */
 
 	//printf("\n\t\t\t\t\t\t\tdataitem % i version % i - timestamp %i",l, r->version, LOCK_GET_TIMESTAMP(l));
 	//fflush(stdout);
@@ -1367,6 +3687,13 @@ static inline w_entry_t *stm_write(stm_tx_t *tx, volatile stm_word_t *addr, stm_
   volatile stm_word_t *lock;
   stm_word_t l, version;
   w_entry_t *w;
+#if DESIGN == WRITE_BACK_ETL
+  w_entry_t *prev = NULL;
+  int i;
+#endif /* DESIGN == WRITE_BACK_ETL */
+#ifdef USE_BLOOM_FILTER
+  stm_word_t h;
+#endif /* USE_BLOOM_FILTER */
 
   PRINT_DEBUG2("==> stm_write(t=%p[%lu-%lu],a=%p,d=%p-%lu,m=0x%lx)\n",
                tx, (unsigned long)tx->start, (unsigned long)tx->end, addr, (void *)value, (unsigned long)value, (unsigned long)mask);
@@ -1395,13 +3722,73 @@ static inline w_entry_t *stm_write(stm_tx_t *tx, volatile stm_word_t *addr, stm_
     /* Locked */
     if (l == LOCK_UNIT) {
       /* Data modified by a unit store: should not last long => retry */
-      goto restart;
+      if (stm_wait_lock(tx, lock, l, lock_wait_policy))
+        goto restart;
     }
+#if DESIGN == WRITE_BACK_CTL
+    /* Only held during commit: wait for the owner (see stm_cm_conflict()) */
+    else if (stm_cm_conflict(tx, lock, l, STM_ABORT_WW_CONFLICT, 0))
+      goto restart;
+    /* Waited too long */
+# ifdef INTERNAL_STATS
+    tx->aborts_locked_write++;
+# endif /* INTERNAL_STATS */
+    stm_rollback(tx, STM_ABORT_WW_CONFLICT);
+    return NULL;
+#else /* DESIGN != WRITE_BACK_CTL */
     /* Do we own the lock? */
-
-    /* Spin while locked (should not last long) */
-    goto restart;
-
+# if DESIGN == WRITE_THROUGH
+    if (tx == (stm_tx_t *)LOCK_GET_ADDR(l)) {
+      /* Yes: log the old value, the lock is released by the first entry */
+      if (tx->w_set.nb_entries == tx->w_set.size)
+        stm_allocate_ws_entries(tx, 1);
+      w = &tx->w_set.entries[tx->w_set.nb_entries];
+      w->no_drop = 1;
+      goto do_write;
+    }
+# else /* DESIGN == WRITE_BACK_ETL */
+    w = (w_entry_t *)LOCK_GET_ADDR(l);
+    /* Simply check if address falls inside our write set (avoids non-faulting load) */
+    if (tx->w_set.entries <= w && w < tx->w_set.entries + tx->w_set.nb_entries) {
+      /* Yes: did we previously write the same address? */
+      while (1) {
+        if (addr == w->addr) {
+          /* No need to add to write set */
+          if (mask != ~(stm_word_t)0) {
+            if (w->mask == 0)
+              w->value = ATOMIC_LOAD(addr);
+            value = (w->value & ~mask) | (value & mask);
+          }
+          w->value = value;
+          w->mask |= mask;
+          return w;
+        }
+        if (w->next == NULL)
+          break;
+        w = w->next;
+      }
+      /* No: add to the entries covered by the lock (all have the same version) */
+      if (tx->w_set.nb_entries == tx->w_set.size) {
+        /* Entries move (the locks are updated) */
+        i = w - tx->w_set.entries;
+        stm_allocate_ws_entries(tx, 1);
+        w = tx->w_set.entries + i;
+      }
+      prev = w;
+      version = prev->version;
+      w = &tx->w_set.entries[tx->w_set.nb_entries];
+      goto do_write;
+    }
+# endif /* DESIGN == WRITE_BACK_ETL */
+    /* Locked by another transaction until it commits: the owner may wait for us */
+    if (l != LOCK_UNIT && stm_cm_conflict(tx, lock, l, STM_ABORT_WW_CONFLICT, 1))
+      goto restart;
+# ifdef INTERNAL_STATS
+    tx->aborts_locked_write++;
+# endif /* INTERNAL_STATS */
+    stm_rollback(tx, STM_ABORT_WW_CONFLICT);
+    return NULL;
+#endif /* DESIGN != WRITE_BACK_CTL */
   }
   /* Not locked */
 #if DESIGN == WRITE_BACK_CTL
@@ -1422,7 +3809,7 @@ static inline w_entry_t *stm_write(stm_tx_t *tx, volatile stm_word_t *addr, stm_
  acquire:
   if (version > tx->end) {
     /* We might have read an older version previously */
-    if (!tx->can_extend || stm_has_read(tx, lock) != NULL) {
+    if (!tx->can_extend || stm_has_read(tx, lock)) {
       /* Read version must be older (otherwise, tx->end >= version) */
       /* Not much we can do: abort */
 
@@ -1433,251 +3820,1646 @@ static inline w_entry_t *stm_write(stm_tx_t *tx, volatile stm_word_t *addr, stm_
       return NULL;
     }
   }
-  /* Acquire lock (ETL) */
 #ifdef IRREVOCABLE_ENABLED
  acquire_no_check:
 #endif /* IRREVOCABLE_ENABLED */
+#if DESIGN != WRITE_BACK_CTL
+  /* Acquire lock (ETL) */
+  if (tx->w_set.nb_entries == tx->w_set.size)
+    stm_allocate_ws_entries(tx, 1);
+  w = &tx->w_set.entries[tx->w_set.nb_entries];
+# if DESIGN == WRITE_THROUGH
+  if (ATOMIC_CAS_FULL(lock, l, LOCK_SET_ADDR_WRITE((stm_word_t)tx)) == 0)
+    goto restart;
+  /* Keep the incarnation number for rollback */
+  w->version = l;
+  w->no_drop = 0;
+# else /* DESIGN == WRITE_BACK_ETL */
+  if (ATOMIC_CAS_FULL(lock, l, LOCK_SET_ADDR_WRITE((stm_word_t)w)) == 0)
+    goto restart;
+# endif /* DESIGN == WRITE_BACK_ETL */
   /* We own the lock here (ETL) */
-do_write:
+ do_write:
+  tx->w_set.nb_entries++;
+#else /* DESIGN == WRITE_BACK_CTL */
   /* Add address to write set */
-#if DESIGN != WRITE_BACK_ETL
   if (tx->w_set.nb_entries == tx->w_set.size)
     stm_allocate_ws_entries(tx, 1);
   w = &tx->w_set.entries[tx->w_set.nb_entries++];
-#endif /* DESIGN != WRITE_BACK_ETL */
+#endif /* DESIGN == WRITE_BACK_CTL */
   w->addr = addr;
   w->mask = mask;
   w->lock = lock;
+#if DESIGN == WRITE_THROUGH
+  if (mask != 0) {
+    /* Remember old value (undo log) and update memory */
+    w->value = ATOMIC_LOAD(addr);
+    if (mask != ~(stm_word_t)0)
+      value = (w->value & ~mask) | (value & mask);
+    ATOMIC_STORE(addr, value);
+  }
+#else /* DESIGN != WRITE_THROUGH */
   if (mask == 0) {
     /* Do not write anything */
-#ifndef NDEBUG
+# ifndef NDEBUG
     w->value = 0;
-#endif /* ! NDEBUG */
+# endif /* ! NDEBUG */
   } else {
+# if DESIGN == WRITE_BACK_ETL
+    /* Memory cannot change while we own the lock: merge partial writes now */
+    if (mask != ~(stm_word_t)0)
+      value = (ATOMIC_LOAD(addr) & ~mask) | (value & mask);
+# endif /* DESIGN == WRITE_BACK_ETL */
     /* Remember new value */
     w->value = value;
   }
-# ifndef NDEBUG
-  w->version = version;
-# endif
-  w->no_drop = 1;
-# ifdef USE_BLOOM_FILTER
-  tx->w_set.bloom |= FILTER_BITS(addr) ;
-# endif /* USE_BLOOM_FILTER */
+#endif /* DESIGN != WRITE_THROUGH */
+#if DESIGN == WRITE_BACK_ETL
+  /* Version to restore upon abort */
+  w->version = version;
+  w->next = NULL;
+  if (prev != NULL)
+    prev->next = w;
+#elif DESIGN == WRITE_BACK_CTL
+# ifndef NDEBUG
+  w->version = version;
+# endif /* ! NDEBUG */
+  w->no_drop = 1;
+#endif /* DESIGN == WRITE_BACK_CTL */
+# ifdef USE_BLOOM_FILTER
+  h = SET_HASH(addr);
+  tx->w_set.bloom[FILTER_WORD(FILTER_BIT1(h))] |= FILTER_MASK(FILTER_BIT1(h));
+  tx->w_set.bloom[FILTER_WORD(FILTER_BIT2(h))] |= FILTER_MASK(FILTER_BIT2(h));
+# endif /* USE_BLOOM_FILTER */
+# ifdef WRITE_SET_INDEX
+  stm_ws_index_add(&tx->w_set);
+# endif /* WRITE_SET_INDEX */
+
+
+#ifdef IRREVOCABLE_ENABLED
+  if (!tx->irrevocable && ATOMIC_LOAD_ACQ(&irrevocable)) {
+    stm_rollback(tx, STM_ABORT_IRREVOCABLE);
+    return NULL;
+  }
+#endif /* IRREVOCABLE_ENABLED */
+
+  return w;
+}
+
+/*
+ * Store a word-sized value in a unit transaction.
+ */
+static inline int stm_unit_write(volatile stm_word_t *addr, stm_word_t value, stm_word_t mask, stm_word_t *timestamp)
+{
+  volatile stm_word_t *lock;
+  stm_word_t l;
+
+  PRINT_DEBUG2("==> stm_unit_write(a=%p,d=%p-%lu,m=0x%lx)\n",
+               addr, (void *)value, (unsigned long)value, (unsigned long)mask);
+
+  /* Get reference to lock */
+  lock = GET_LOCK(addr);
+
+  /* Try to acquire lock */
+ restart:
+  l = ATOMIC_LOAD_ACQ(lock);
+  if (LOCK_GET_OWNED(l)) {
+    /* Locked: wait until lock is free */
+#ifdef WAIT_YIELD
+    sched_yield();
+#endif /* WAIT_YIELD */
+    goto restart;
+  }
+  /* Not locked */
+  if (timestamp != NULL && LOCK_GET_TIMESTAMP(l) > *timestamp) {
+    /* Return current timestamp */
+    *timestamp = LOCK_GET_TIMESTAMP(l);
+    return 0;
+  }
+  /* TODO: would need to store thread ID to be able to kill it (for wait freedom) */
+  if (ATOMIC_CAS_FULL(lock, l, LOCK_UNIT) == 0)
+    goto restart;
+  /* The new version must exceed the old one (lazy clock schemes) */
+  clock_advance(LOCK_GET_TIMESTAMP(l));
+  ATOMIC_STORE(addr, value);
+#ifdef SUPPORTER_COMMIT_LOG
+  ATOMIC_FETCH_INC_FULL(&commit_log_unlogged);
+#endif /* SUPPORTER_COMMIT_LOG */
+  /* Update timestamp with newer value (may exceed VERSION_MAX by up to MAX_THREADS) */
+  l = clock_commit(NULL);
+  if (timestamp != NULL)
+    *timestamp = l;
+#ifdef MULTI_VERSION
+  /* The overwritten value is not kept (unit stores may run outside of
+   * transactional threads, hence they leave old versions to commits) */
+  mv_forget(&mv_chains[lock - locks], l);
+#endif /* MULTI_VERSION */
+  /* Make sure that lock release becomes visible */
+  ATOMIC_STORE_REL(lock, LOCK_SET_TIMESTAMP(l));
+#ifdef SUPPORTER_COMMIT_LOG
+  commit_log_set_unlogged(l);
+  ATOMIC_FETCH_DEC_FULL(&commit_log_unlogged);
+#endif /* SUPPORTER_COMMIT_LOG */
+  if (l >= VERSION_MAX) {
+    /* Block all transactions and reset clock (current thread is not in active transaction) */
+    stm_quiesce_barrier(NULL, rollover_clock, NULL);
+  }
+  return 1;
+}
+
+#ifdef SIGNAL_HANDLER
+/*
+ * Catch signal (to emulate non-faulting load).
+ */
+static void signal_catcher(int sig)
+{
+  sigset_t block_signal;
+  stm_tx_t *tx = stm_get_tx();
+
+  /* A fault might only occur upon a load concurrent with a free (read-after-free) */
+  PRINT_DEBUG("Caught signal: %d\n", sig);
+
+  /* TODO: TX_KILLED should be also allowed */
+  if (tx == NULL || tx->attr.no_retry || GET_STATUS(tx->status) != TX_ACTIVE) {
+    /* There is not much we can do: execution will restart at faulty load */
+    fprintf(stderr, "Error: invalid memory accessed and no longjmp destination\n");
+    exit(1);
+  }
+
+# ifdef INTERNAL_STATS
+  tx->aborts_invalid_memory++;
+# endif /* INTERNAL_STATS */
+
+  /* Unblock the signal since there is no return to signal handler */
+  sigemptyset(&block_signal);
+  sigaddset(&block_signal, sig);
+  pthread_sigmask(SIG_UNBLOCK, &block_signal, NULL);
+
+  /* Will cause a longjmp */
+  stm_rollback(tx, STM_ABORT_SIGNAL);
+}
+#endif /* SIGNAL_HANDLER */
+
+/* ################################################################### *
+ * STM FUNCTIONS
+ * ################################################################### */
+
+/*
+ * Called once (from main) to initialize STM infrastructure.
+ */
+
+#ifdef SUPPORTER_THREAD
+
+/*
+ * Is the current attempt of a transaction doomed by a supporter?
+ */
+static inline int supporter_doomed(stm_tx_t *tx)
+{
+	stm_word_t v = ATOMIC_LOAD_ACQ(&tx->mailbox.verdict);
+
+	return verdict_dooms(v, tx->attempt);
+}
+
+static inline void check_should_abort() {
+	stm_word_t v, end;
+	int n;
+#ifdef SUPPORTER_THREAD_TIMERS
+	stm_time_t t;
+#endif /* SUPPORTER_THREAD_TIMERS */
+	TX_GET;
+
+	/* A single load of the mailbox in the common case */
+	v = ATOMIC_LOAD_ACQ(&tx->mailbox.verdict);
+	if (!verdict_current(v, tx->attempt))
+		return;
+
+	if (VERDICT_DOOMED(v)){
+		tx->running_transaction=0;
+		tx->aborts_supporter_validate_read++;
+#ifdef SUPPORTER_THREAD_TIMERS
+		/* Time between the verdict of the supporter and the abort */
+		t=STM_TIMER_READ()-tx->mailbox.doom_time;
+		tx->total_tx_doomed_time+=t;
+		tx->doom_latency[supporter_latency_bucket(t)]++;
+#endif /* SUPPORTER_THREAD_TIMERS */
+#if CM == CM_DELAY || CM == CM_MODULAR
+		stm_cm_doomed(tx, ATOMIC_LOAD(&tx->mailbox.doom_stripe));
+#endif /* CM == CM_DELAY || CM == CM_MODULAR */
+        stm_rollback(tx, STM_ABORT_VAL_READ);
+	} else {
+		//extend tx
+		end = tx->start + VERDICT_SPAN(v);
+		if (tx->end<end) {
+			/* Entries read after the snapshot of the supporter must not
+			 * have changed since our own snapshot */
+			n = VERDICT_COUNT(v);
+			if (n < tx->r_set.nb_entries
+			    && !_stm_validate_range(tx, &tx->r_set, n, tx->r_set.nb_entries - n, tx->end))
+				return;
+			tx->end=end;
+			tx->extended++;
+		}
+	}
+}
+
+#ifdef SUPPORTER_DOOM_SIGNAL
+/*
+ * Catch the signal sent by a supporter to a doomed transaction.  The
+ * transaction is only rolled back if it runs application code that has
+ * been declared safe to interrupt with stm_async_abort(); otherwise it
+ * will notice at its next poll.
+ */
+static void doom_catcher(int sig)
+{
+  sigset_t block_signal;
+  stm_tx_t *tx = stm_get_tx();
+
+  if (tx == NULL || !tx->async_abort || tx->nesting == 0)
+    return;
+  if (!supporter_doomed(tx))
+    return;
+  tx->async_abort = 0;
+
+  /* Unblock the signal since there is no return to signal handler */
+  sigemptyset(&block_signal);
+  sigaddset(&block_signal, sig);
+  pthread_sigmask(SIG_UNBLOCK, &block_signal, NULL);
+
+  /* Will cause a longjmp */
+  check_should_abort();
+}
+#endif /* SUPPORTER_DOOM_SIGNAL */
+
+/*
+ * Compute an absolute deadline for pthread_cond_timedwait().
+ */
+static inline void supporter_deadline(struct timespec *ts, long us)
+{
+  clock_gettime(CLOCK_REALTIME, ts);
+  ts->tv_sec += us / 1000000;
+  ts->tv_nsec += (us % 1000000) * 1000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+/*
+ * Park a supporter that is no longer needed by its group.  Returns 0 if
+ * the supporter must exit (retired or library shutting down).
+ */
+static int supporter_park(supporter_t *s)
+{
+  struct timespec deadline;
+  int run;
+
+  pthread_mutex_lock(&supporter_mutex);
+  s->state = SUPPORTER_PARKED;
+  supporter_parks++;
+  supporter_deadline(&deadline, SUPPORTER_RETIRE_DELAY * 1000L);
+  while (s->rank >= s->group->active && !supporter_stop) {
+    if (pthread_cond_timedwait(&supporter_cond, &supporter_mutex, &deadline) == ETIMEDOUT
+        && s->rank >= s->group->active) {
+      /* Parked for too long: give the core back */
+      supporter_retires++;
+      break;
+    }
+  }
+  run = (s->rank < s->group->active && !supporter_stop);
+  s->state = (run ? SUPPORTER_RUNNING : SUPPORTER_RETIRED);
+  pthread_mutex_unlock(&supporter_mutex);
+
+  return run;
+}
+
+/*
+ * Wait until the clock moves past now (or the supporter is no longer
+ * needed): spin for a bounded number of iterations, then yield or sleep
+ * until the next commit according to the wait policy.
+ */
+static void supporter_wait_commit(supporter_t *s, stm_word_t now)
+{
+  stm_time_t start;
+  int spins, seq;
+
+  for (spins = 0; CLOCK <= now; spins++) {
+    if (s->rank >= s->group->active || supporter_stop || supporter_paused)
+      return;
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+    if (ATOMIC_LOAD(&supporter_chunk_jobs) > 0)
+      return;
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_PREACQUIRE
+    if (ATOMIC_LOAD(&supporter_lock_jobs) > 0)
+      return;
+#endif /* SUPPORTER_PREACQUIRE */
+    if (spins < supporter_spin_budget || supporter_wait_policy == SUPPORTER_WAIT_SPIN) {
+      __asm volatile ("pause" ::: "memory");
+      continue;
+    }
+    start = STM_TIMER_READ();
+    if (supporter_wait_policy == SUPPORTER_WAIT_YIELD) {
+      sched_yield();
+    } else {
+      seq = supporter_commit_seq;
+      ATOMIC_FETCH_INC_FULL(&supporter_sleepers);
+      if (CLOCK <= now && s->rank < s->group->active && !supporter_stop && !supporter_paused
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+          && ATOMIC_LOAD(&supporter_chunk_jobs) == 0
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_PREACQUIRE
+          && ATOMIC_LOAD(&supporter_lock_jobs) == 0
+#endif /* SUPPORTER_PREACQUIRE */
+          )
+        supporter_futex_wait(&supporter_commit_seq, seq, SUPPORTER_PARK_TIMEOUT);
+      ATOMIC_FETCH_DEC_FULL(&supporter_sleepers);
+    }
+    s->parked_time += STM_TIMER_READ() - start;
+    s->waits_park++;
+    return;
+  }
+  if (spins > 0)
+    s->waits_spin++;
+}
+
+#ifdef SUPPORTER_COMMIT_LOG
+/*
+ * Check the locks released by the commits with timestamps in (end, now]
+ * against the read signature of the transaction, looking up their
+ * committers in the index.  Returns 1 if none of them can be in the read
+ * set (the transaction is still valid at now), 0 if a full validation is
+ * needed (the reason is counted in the stats of supporter s).
+ */
+static int supporter_check_commit_log(supporter_t *s, stm_tx_t *tx, stm_word_t end, stm_word_t now)
+{
+  commit_log_record_t *r;
+  commit_log_entry_t *e;
+  stm_tx_t *c;
+  stm_word_t t, info, k, pos;
+  int slot;
+
+  if (ATOMIC_LOAD_ACQ(&commit_log_unlogged) > 0 || ATOMIC_LOAD_ACQ(&commit_log_unlogged_ts) > end) {
+    s->log_unlogged++;
+    return 0;
+  }
+  if (now - end > COMMIT_LOG_INDEX_SIZE) {
+    s->log_overrun++;
+    return 0;
+  }
+
+  for (t = end + 1; t <= now; t++) {
+    r = &commit_log_index[t & (COMMIT_LOG_INDEX_SIZE - 1)];
+    if (ATOMIC_LOAD_ACQ(&r->ts) != t) {
+      /* Not published yet, or already overwritten by a later timestamp */
+      s->log_pending++;
+      return 0;
+    }
+    info = ATOMIC_LOAD(&r->info);
+    ATOMIC_MB_READ;
+    if (ATOMIC_LOAD(&r->ts) != t) {
+      s->log_pending++;
+      return 0;
+    }
+    slot = COMMIT_LOG_SLOT(info);
+    if (slot == COMMIT_LOG_NONE)
+      continue;
+    c = (stm_tx_t *)stm_tx_slots[slot].tx;
+    if (c == NULL) {
+      s->log_unlogged++;
+      return 0;
+    }
+    /* Entries of timestamp t end at pos, timestamps decrease before */
+    pos = COMMIT_LOG_POS(info);
+    for (k = pos; k > 0; k--) {
+      if (pos - k >= COMMIT_LOG_SIZE) {
+        s->log_overrun++;
+        return 0;
+      }
+      e = &c->clog[(k - 1) & (COMMIT_LOG_SIZE - 1)];
+      if (e->ts != t)
+        break;
+      if (tx->r_sig[READ_SIG_WORD(e->idx)] & READ_SIG_MASK(e->idx)) {
+        s->log_hits++;
+        return 0;
+      }
+    }
+    /* Oldest entry read (k - 1) must not have been overwritten meanwhile */
+    if (ATOMIC_LOAD_ACQ(&c->clog_head) + 1 > k + COMMIT_LOG_SIZE) {
+      s->log_overrun++;
+      return 0;
+    }
+  }
+
+  /* A committer may have exited (and its slot been reused) meanwhile */
+  if (ATOMIC_LOAD_ACQ(&commit_log_unlogged_ts) > end) {
+    s->log_unlogged++;
+    return 0;
+  }
+
+  return 1;
+}
+#endif /* SUPPORTER_COMMIT_LOG */
+
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+/*
+ * Validate one chunk of a published job.  Chunk boundaries are aligned
+ * on cache lines of the read set array so that helpers never share one.
+ */
+static void supporter_validate_chunk(supporter_chunk_job_t *job, int chunk)
+{
+  long first, last, skew;
+
+  skew = ((uintptr_t)RS_BASE(&job->rs) & (SUPPORTER_CACHELINE - 1)) / sizeof(*RS_BASE(&job->rs));
+  first = chunk * (long)SUPPORTER_CHUNK_SIZE - skew;
+  last = (chunk + 1) * (long)SUPPORTER_CHUNK_SIZE - skew;
+  if (first < 0)
+    first = 0;
+  if (last > job->nb_entries)
+    last = job->nb_entries;
+  if (!job->failed && !_stm_validate_range(job->tx, &job->rs, first, last - first, job->end))
+    job->failed = 1;
+  ATOMIC_FETCH_INC_FULL(&job->done);
+}
+
+/*
+ * Claim and validate chunks of the job until none is left.  The chunk
+ * counter is tagged with the job generation, so that a helper cannot
+ * claim a chunk of a job that has been replaced meanwhile.  Returns the
+ * number of chunks validated.
+ */
+static int supporter_work_chunks(supporter_chunk_job_t *job)
+{
+  stm_word_t n;
+  int done = 0;
+
+  while (1) {
+    n = ATOMIC_LOAD_ACQ(&job->next);
+    if ((n & SUPPORTER_CHUNK_MASK) >= job->nb_chunks || (n >> SUPPORTER_CHUNK_BITS) != job->gen)
+      break;
+    if (ATOMIC_CAS_FULL(&job->next, n, n + 1) == 0)
+      continue;
+    supporter_validate_chunk(job, (int)(n & SUPPORTER_CHUNK_MASK));
+    done++;
+  }
+  return done;
+}
+
+/*
+ * Help validating the chunks published by other supporters.
+ */
+static void supporter_help(supporter_t *s)
+{
+  supporter_group_t *g;
+  supporter_t *owner;
+  int n, r;
+
+  if (ATOMIC_LOAD_ACQ(&supporter_chunk_jobs) == 0)
+    return;
+  for (n = 0; n < nb_supporter_groups && !supporter_stop; n++) {
+    if ((g = supporter_groups[n]) == NULL)
+      continue;
+    for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+      owner = &g->supporters[r];
+      if (owner != s && owner->state != SUPPORTER_IDLE)
+        s->chunks_helped += supporter_work_chunks(&owner->job);
+    }
+  }
+}
+
+/*
+ * Validate a large read set in parallel: publish it as a job of chunks,
+ * validate chunks until none is left and wait for the helpers.  All
+ * chunks are validated against the same end timestamp, and the caller
+ * turns the combined result into a single decision.
+ */
+static int supporter_validate_parallel(supporter_t *s, stm_tx_t *tx, int n, stm_word_t end)
+{
+  supporter_chunk_job_t *job = &s->job;
+  long skew;
+
+  job->tx = tx;
+  job->rs = tx->r_set;
+  job->nb_entries = n;
+  job->end = end;
+  job->failed = 0;
+  job->done = 0;
+  skew = ((uintptr_t)RS_BASE(&job->rs) & (SUPPORTER_CACHELINE - 1)) / sizeof(*RS_BASE(&job->rs));
+  job->nb_chunks = (job->nb_entries + skew + SUPPORTER_CHUNK_SIZE - 1) / SUPPORTER_CHUNK_SIZE;
+  job->gen++;
+  /* Publish */
+  ATOMIC_STORE_REL(&job->next, (stm_word_t)job->gen << SUPPORTER_CHUNK_BITS);
+  ATOMIC_FETCH_INC_FULL(&supporter_chunk_jobs);
+  if (ATOMIC_LOAD(&supporter_sleepers) > 0)
+    supporter_wake();
+
+  supporter_work_chunks(job);
+  while (ATOMIC_LOAD_ACQ(&job->done) < job->nb_chunks)
+    __asm volatile ("pause" ::: "memory");
+
+  ATOMIC_FETCH_DEC_FULL(&supporter_chunk_jobs);
+  s->validations_parallel++;
+
+  return !job->failed;
+}
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+
+#ifdef SUPPORTER_PREACQUIRE
+/*
+ * Acquire the commit locks of one chunk of the write set (in reverse
+ * order, as stm_commit() does).  Several threads may lock chunks of the
+ * same transaction: a lock owned through another entry of the write set
+ * is ours.  Returns the number of locks acquired and flags the commit
+ * as failed if a lock is owned by another transaction.
+ */
+static int stm_acquire_chunk(stm_tx_t *tx, int chunk)
+{
+  w_entry_t *w, *first;
+  stm_word_t l;
+  int n, acquired = 0;
+
+  first = tx->w_set.entries + chunk * SUPPORTER_PREACQUIRE_CHUNK;
+  n = tx->w_set.nb_entries - chunk * SUPPORTER_PREACQUIRE_CHUNK;
+  w = first + (n < SUPPORTER_PREACQUIRE_CHUNK ? n : SUPPORTER_PREACQUIRE_CHUNK);
+  do {
+    w--;
+ restart:
+    l = ATOMIC_LOAD(w->lock);
+    if (LOCK_GET_OWNED(l)) {
+      if (tx->w_set.entries <= (w_entry_t *)LOCK_GET_ADDR(l) && (w_entry_t *)LOCK_GET_ADDR(l) < tx->w_set.entries + tx->w_set.nb_entries)
+        continue;
+      tx->acq_failed = 1;
+      break;
+    }
+    if (ATOMIC_CAS_FULL(w->lock, l, LOCK_SET_ADDR_WRITE((stm_word_t)w)) == 0)
+      goto restart;
+    w->no_drop = 0;
+    w->version = LOCK_GET_TIMESTAMP(l);
+    acquired++;
+  } while (w > first);
+
+  return acquired;
+}
+
+/*
+ * Hand each stripe locked in parallel over to the last entry of the
+ * write set that covers it, as with sequential acquisition (in reverse
+ * order): write-back releases a stripe at its owner entry, hence the
+ * entries after the owner would otherwise be installed once the stripe
+ * is released.  Called once all the chunks are locked.
+ */
+static void stm_acquire_reorder(stm_tx_t *tx)
+{
+  w_entry_t *w, *owner;
+
+  w = tx->w_set.entries + tx->w_set.nb_entries;
+  while (w > tx->w_set.entries) {
+    w--;
+    owner = (w_entry_t *)LOCK_GET_ADDR(ATOMIC_LOAD(w->lock));
+    if (owner < w) {
+      w->version = owner->version;
+      w->no_drop = 0;
+      owner->no_drop = 1;
+      ATOMIC_STORE(w->lock, LOCK_SET_ADDR_WRITE((stm_word_t)w));
+    }
+  }
+}
+
+/*
+ * Claim and lock chunks of the write set of a committing transaction
+ * until none is left (chunks claimed after a failure are skipped).  The
+ * claim counter is tagged with the commit generation, as for read set
+ * chunks.  Returns the number of locks acquired.
+ */
+static int supporter_acquire_chunks(stm_tx_t *tx)
+{
+  stm_word_t n;
+  int acquired, total = 0;
+
+  while (1) {
+    n = ATOMIC_LOAD_ACQ(&tx->acq_next);
+    if ((n & SUPPORTER_ACQ_MASK) >= tx->acq_chunks || (n >> SUPPORTER_ACQ_BITS) != tx->acq_gen)
+      break;
+    if (ATOMIC_CAS_FULL(&tx->acq_next, n, n + 1) == 0)
+      continue;
+    acquired = (tx->acq_failed ? 0 : stm_acquire_chunk(tx, (int)(n & SUPPORTER_ACQ_MASK)));
+    /* Owners and versions must be visible before the chunk is counted */
+    ATOMIC_FETCH_ADD_FULL(&tx->acq_locked, acquired);
+    ATOMIC_FETCH_INC_FULL(&tx->acq_done);
+    total += acquired;
+  }
+  return total;
+}
+
+/*
+ * Called by a committing worker with a large write set: publish the
+ * write set so that idle supporters of its group help acquiring the
+ * commit locks, lock chunks until none is left and wait for the helpers.
+ * Returns 0 if a lock is owned by another transaction (the locks
+ * acquired are accounted in the write set and released by rollback).
+ */
+static int supporter_acquire_parallel(stm_tx_t *tx)
+{
+  tx->acq_failed = 0;
+  tx->acq_done = 0;
+  tx->acq_locked = 0;
+  tx->acq_chunks = (tx->w_set.nb_entries + SUPPORTER_PREACQUIRE_CHUNK - 1) / SUPPORTER_PREACQUIRE_CHUNK;
+  tx->acq_gen++;
+  /* Publish */
+  ATOMIC_STORE_REL(&tx->acq_next, (stm_word_t)tx->acq_gen << SUPPORTER_ACQ_BITS);
+  ATOMIC_FETCH_INC_FULL(&supporter_lock_jobs);
+
+  supporter_acquire_chunks(tx);
+  while (ATOMIC_LOAD_ACQ(&tx->acq_done) < tx->acq_chunks)
+    __asm volatile ("pause" ::: "memory");
+
+  ATOMIC_FETCH_DEC_FULL(&supporter_lock_jobs);
+  tx->w_set.nb_acquired += (int)tx->acq_locked;
+  tx->preacquired++;
+  if (!tx->acq_failed)
+    stm_acquire_reorder(tx);
+
+  return !tx->acq_failed;
+}
+
+/*
+ * Help the workers of the group that are acquiring their commit locks.
+ */
+static void supporter_help_commit(supporter_t *s)
+{
+  supporter_group_t *g = s->group;
+  stm_tx_t *tx;
+  int i;
+
+  if (ATOMIC_LOAD_ACQ(&supporter_lock_jobs) == 0)
+    return;
+  for (i = g->base_thread_id; i < g->base_thread_id + g->supported_threads; i++) {
+    if ((tx = (stm_tx_t *)stm_tx_slots[i].tx) != NULL)
+      s->locks_acquired += supporter_acquire_chunks(tx);
+  }
+}
+#endif /* SUPPORTER_PREACQUIRE */
+
+/*
+ * Rescan the read set of a transaction (in parallel if it is large).
+ */
+static inline int supporter_validate_full(supporter_t *s, stm_tx_t *tx, int n, stm_word_t end)
+{
+  s->entries += n;
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+  if (n >= SUPPORTER_CHUNK_THRESHOLD)
+    return supporter_validate_parallel(s, tx, n, end);
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+  return _stm_validate_range(tx, &tx->r_set, 0, n, end);
+}
+
+#if CM == CM_DELAY || CM == CM_MODULAR
+/*
+ * Find the stripe that invalidated a read set (for the contention
+ * manager of the doomed transaction): the first of the n entries whose
+ * lock is newer than end.  Returns its index + 1 (0 if none is found,
+ * e.g., because the worker has restarted meanwhile).
+ */
+static stm_word_t supporter_doom_stripe(stm_tx_t *tx, int n, stm_word_t end)
+{
+  int k;
+
+  k = validate_end(&tx->r_set, 0, n, end);
+  if (k >= n)
+    return 0;
+  return (stm_word_t)(RS_LOCK(&tx->r_set, k) - locks) + 1;
+}
+#endif /* CM == CM_DELAY || CM == CM_MODULAR */
+
+/*
+ * Validate the transaction running in a worker slot and publish the
+ * verdict.  Returns 0 if the transaction did not need validation (or is
+ * being validated by another supporter).
+ */
+static int supporter_validate(supporter_t *s, int slot)
+{
+	stm_tx_t *stm_tx_pointer;
+	supporter_mailbox_t *mb;
+	stm_word_t now, gen, attempt, start, end, span;
+	unsigned long aborts;
+	int valid, n;
+
+	gen=ATOMIC_LOAD_ACQ(&stm_tx_slots[slot].gen);
+	stm_tx_pointer=(stm_tx_t *)stm_tx_slots[slot].tx;
+	if (stm_tx_pointer==NULL) return 0;
+	if (!stm_tx_pointer->running_transaction || supporter_doomed(stm_tx_pointer)) return 0;
+	mb=&stm_tx_pointer->mailbox;
+
+	/* Stolen tasks may be validated concurrently by their owner */
+	if (ATOMIC_CAS_FULL(&mb->validator, 0, 1) == 0) return 0;
+
+	/* The thread may have exited (and its descriptor be reused) meanwhile */
+	if (ATOMIC_LOAD(&stm_tx_slots[slot].gen) != gen || (gen & 1) == 0) {
+		ATOMIC_STORE_REL(&mb->validator, 0);
+		return 0;
+	}
+
+	/* Snapshot of the attempt: the verdict only covers these entries */
+	attempt=ATOMIC_LOAD_ACQ(&stm_tx_pointer->attempt);
+	if (stm_tx_pointer->ro && !stm_tx_pointer->ro_logged) {
+		/* No read set: cannot tell whether the snapshot can be extended */
+		ATOMIC_STORE_REL(&mb->validator, 0);
+		return 0;
+	}
+	start=stm_tx_pointer->start;
+	end=stm_tx_pointer->end;
+	n=stm_tx_pointer->r_set.nb_entries;
+	now=CLOCK;
+
+	if (now<=end) {
+		ATOMIC_STORE_REL(&mb->validator, 0);
+		return 0;
+	}
+
+	mb->validations++;
+	s->validations++;
+	mb->validation_lag+=now-end;
+	if (mb->validation_lag_max<now-end)
+		mb->validation_lag_max=now-end;
+
+#ifdef SUPPORTER_COMMIT_LOG
+	if (supporter_check_commit_log(s, stm_tx_pointer, end, now)) {
+		s->validations_log++;
+		valid = 1;
+	} else {
+		s->validations_full++;
+		valid = supporter_validate_full(s, stm_tx_pointer, n, end);
+	}
+#else /* ! SUPPORTER_COMMIT_LOG */
+	valid = supporter_validate_full(s, stm_tx_pointer, n, end);
+#endif /* ! SUPPORTER_COMMIT_LOG */
+	s->sched_validations[s->pass_policy]++;
+	/* History for the abort likelihood policy */
+	aborts=stm_tx_pointer->total_aborts;
+	mb->abort_score=(mb->abort_score * 7 + (!valid || aborts != mb->seen_aborts ? 1024 : 0)) / 8;
+	mb->seen_aborts=aborts;
+	if (valid) {
+		/* Clamping only makes the verdict weaker */
+		span = (now - start < VERDICT_SPAN_MAX ? now - start : VERDICT_SPAN_MAX);
+		ATOMIC_STORE_REL(&mb->verdict, VERDICT(attempt, (n < VERDICT_COUNT_MAX ? n : VERDICT_COUNT_MAX), span, 0));
+	} else {
+#ifdef SUPPORTER_THREAD_TIMERS
+		mb->doom_time = STM_TIMER_READ();
+#endif /* SUPPORTER_THREAD_TIMERS */
+#if CM == CM_DELAY || CM == CM_MODULAR
+		mb->doom_stripe = supporter_doom_stripe(stm_tx_pointer, n, end);
+#endif /* CM == CM_DELAY || CM == CM_MODULAR */
+		ATOMIC_STORE_REL(&mb->verdict, VERDICT(attempt, 0, 0, 1));
+		s->sched_dooms[s->pass_policy]++;
+		s->sched_detect_lag[s->pass_policy]+=now-end;
+		s->sched_detect_time[s->pass_policy]+=STM_TIMER_READ()-s->pass_start;
+#ifdef SUPPORTER_DOOM_SIGNAL
+		/* Do not wait for the next poll of a long computation */
+		ATOMIC_MB_FULL;
+		if (stm_tx_pointer->async_abort && pthread_kill(stm_tx_pointer->thread, SUPPORTER_DOOM_SIGNO) == 0)
+			mb->doom_signals++;
+#endif /* SUPPORTER_DOOM_SIGNAL */
+	}
+
+	/* Too late to be of any use? */
+	if (ATOMIC_LOAD(&stm_tx_pointer->attempt) != attempt || !stm_tx_pointer->running_transaction)
+		s->sched_wasted[s->pass_policy]++;
+
+	ATOMIC_STORE_REL(&mb->validator, 0);
+	return 1;
+}
+
+#ifdef SUPPORTER_WORK_STEALING
+/*
+ * Validation tasks (worker slots) are kept in a bounded Chase-Lev deque
+ * per supporter: the owner pushes and pops at the bottom, thieves steal
+ * the oldest tasks at the top.
+ */
+static inline int supporter_push(supporter_t *s, int slot)
+{
+  stm_word_t b = s->dq_bottom;
+
+  if (b - ATOMIC_LOAD_ACQ(&s->dq_top) >= SUPPORTER_DEQUE_SIZE)
+    return 0;
+  s->dq_tasks[b & (SUPPORTER_DEQUE_SIZE - 1)] = slot;
+  ATOMIC_STORE_REL(&s->dq_bottom, b + 1);
+  return 1;
+}
+
+static inline int supporter_pop(supporter_t *s)
+{
+  stm_word_t b, t;
+  int slot;
+
+  b = s->dq_bottom - 1;
+  ATOMIC_STORE(&s->dq_bottom, b);
+  ATOMIC_MB_FULL;
+  t = ATOMIC_LOAD(&s->dq_top);
+  if ((long)(b - t) < 0) {
+    /* Empty */
+    ATOMIC_STORE(&s->dq_bottom, t);
+    return -1;
+  }
+  slot = s->dq_tasks[b & (SUPPORTER_DEQUE_SIZE - 1)];
+  if (b == t) {
+    /* Last task: race with thieves */
+    if (ATOMIC_CAS_FULL(&s->dq_top, t, t + 1) == 0)
+      slot = -1;
+    ATOMIC_STORE(&s->dq_bottom, t + 1);
+  }
+  return slot;
+}
+
+static inline int supporter_steal_from(supporter_t *victim)
+{
+  stm_word_t b, t;
+  int slot;
+
+  t = ATOMIC_LOAD_ACQ(&victim->dq_top);
+  ATOMIC_MB_FULL;
+  b = ATOMIC_LOAD_ACQ(&victim->dq_bottom);
+  if ((long)(b - t) <= 0)
+    return -1;
+  slot = victim->dq_tasks[t & (SUPPORTER_DEQUE_SIZE - 1)];
+  if (ATOMIC_CAS_FULL(&victim->dq_top, t, t + 1) == 0)
+    return -1;
+  return slot;
+}
+
+/*
+ * Steal and validate stale transactions queued by the other supporters
+ * (in any group) until all deques look empty.
+ */
+static void supporter_steal(supporter_t *s)
+{
+  supporter_group_t *g;
+  supporter_t *victim;
+  int n, r, slot, found;
+
+  do {
+    found = 0;
+    for (n = 0; n < nb_supporter_groups && !supporter_stop; n++) {
+      if ((g = supporter_groups[n]) == NULL)
+        continue;
+      for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+        victim = &g->supporters[r];
+        if (victim == s || victim->state == SUPPORTER_IDLE)
+          continue;
+        s->steal_attempts++;
+        if ((slot = supporter_steal_from(victim)) < 0)
+          continue;
+        found = 1;
+        if (supporter_validate(s, slot))
+          s->steals++;
+      }
+    }
+  } while (found && !supporter_stop);
+}
+#endif /* SUPPORTER_WORK_STEALING */
+
+/*
+ * Priority of a transaction under a scheduling policy (highest first).
+ */
+static inline stm_word_t supporter_sched_key(stm_tx_t *tx, int policy)
+{
+  switch (policy) {
+   case SUPPORTER_SCHED_LARGEST:
+     return tx->r_set.nb_entries;
+   case SUPPORTER_SCHED_OLDEST:
+     return ~tx->start;
+   case SUPPORTER_SCHED_ABORT:
+     return tx->mailbox.abort_score;
+  }
+  return 0;
+}
+
+/*
+ * Validate (or queue) the transactions of a pass by decreasing priority.
+ */
+static void supporter_schedule(supporter_t *s, int n)
+{
+  supporter_task_t t;
+  int i, j;
+
+  /* Few transactions per supporter: insertion sort */
+  for (i = 1; i < n; i++) {
+    t = s->tasks[i];
+    for (j = i; j > 0 && s->tasks[j - 1].key < t.key; j--)
+      s->tasks[j] = s->tasks[j - 1];
+    s->tasks[j] = t;
+  }
+#ifdef SUPPORTER_WORK_STEALING
+  /* The deque is popped from the bottom: push the lowest priority first */
+  for (i = n - 1; i >= 0; i--) {
+    if (!supporter_push(s, s->tasks[i].slot))
+      supporter_validate(s, s->tasks[i].slot);
+  }
+#else /* ! SUPPORTER_WORK_STEALING */
+  for (i = 0; i < n; i++)
+    supporter_validate(s, s->tasks[i].slot);
+#endif /* ! SUPPORTER_WORK_STEALING */
+}
+
+/*
+ * Wait until the supporters are resumed (or stopped).  The supporter
+ * does not access any descriptor while paused.
+ */
+static void supporter_pause_wait(supporter_t *s)
+{
+  pthread_mutex_lock(&supporter_mutex);
+  s->state = SUPPORTER_PAUSED;
+  pthread_cond_broadcast(&supporter_cond);
+  while (supporter_paused && !supporter_stop)
+    pthread_cond_wait(&supporter_cond, &supporter_mutex);
+  s->state = SUPPORTER_RUNNING;
+  pthread_mutex_unlock(&supporter_mutex);
+}
+
+/*
+ * Main loop of a supporter thread.  The supporters of a group split its
+ * transactions: supporter of rank r validates worker slots base+r,
+ * base+r+active, ...  With work stealing, stale transactions are queued
+ * and idle supporters of any group help validating them.
+ */
+static void *supporter_run(void *data)
+{
+	supporter_t *s = (supporter_t *)data;
+	supporter_group_t *g = s->group;
+	int i, n, active;
+	stm_word_t now=0;
+
+	stm_tx_t *stm_tx_pointer;
+
+	/* Move this thread close to the workers it supports */
+	s->cpu = topo_supporter_cpu(g->base_thread_id, s->rank);
+	topo_bind(s->cpu);
+
+	if ((s->tasks = (supporter_task_t *)malloc(g->supported_threads * sizeof(supporter_task_t))) == NULL) {
+		perror("malloc supporter tasks");
+		exit(1);
+	}
+
+	while(!supporter_stop) {
+
+		if (supporter_paused) {
+			supporter_pause_wait(s);
+			continue;
+		}
+		if (s->rank >= (active = g->active)) {
+			if (!supporter_park(s))
+				break;
+			continue;
+		}
+
+		supporter_wait_commit(s, now);
+#ifdef SUPPORTER_PREACQUIRE
+		/* Commits are on the critical path: help them first */
+		supporter_help_commit(s);
+#endif /* SUPPORTER_PREACQUIRE */
+		now=CLOCK;
+		s->pass_policy=supporter_sched_policy;
+		s->pass_start=STM_TIMER_READ();
+		n=0;
+
+		for (i=g->base_thread_id+s->rank; i<g->base_thread_id+g->supported_threads; i+=active) {
+
+			stm_tx_pointer=(stm_tx_t *)stm_tx_slots[i].tx;
+			if (stm_tx_pointer==NULL) continue;
+			if (!stm_tx_pointer->running_transaction || supporter_doomed(stm_tx_pointer)) continue;
+			if (stm_tx_pointer->ro && !stm_tx_pointer->ro_logged) continue;
+
+			if (now<=stm_tx_pointer->end) {
+				continue;
+			}
+
+			if (s->pass_policy != SUPPORTER_SCHED_RR) {
+				s->tasks[n].slot=i;
+				s->tasks[n].key=supporter_sched_key(stm_tx_pointer, s->pass_policy);
+				n++;
+				continue;
+			}
+#ifdef SUPPORTER_WORK_STEALING
+			if (supporter_push(s, i)) continue;
+#endif /* SUPPORTER_WORK_STEALING */
+			supporter_validate(s, i);
+		}
+		if (n > 0)
+			supporter_schedule(s, n);
+
+#ifdef SUPPORTER_WORK_STEALING
+		while ((i = supporter_pop(s)) >= 0)
+			supporter_validate(s, i);
+		supporter_steal(s);
+#endif /* SUPPORTER_WORK_STEALING */
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+		supporter_help(s);
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+		s->passes++;
+		/* Verdicts of the pass are already behind the clock */
+		if (CLOCK!=now)
+			s->stale_passes++;
+	}
+
+	free(s->tasks);
+	s->tasks=NULL;
+
+	return NULL;
+}
+
+/*
+ * Start (or wake up) the supporter of given rank.  Must be called with
+ * supporter_mutex held, after the pool size of the group has been raised.
+ */
+static void supporter_start(supporter_group_t *g, int rank)
+{
+  supporter_t *s = &g->supporters[rank];
+
+  switch (s->state) {
+   case SUPPORTER_PARKED:
+     pthread_cond_broadcast(&supporter_cond);
+     break;
+   case SUPPORTER_RETIRED:
+     pthread_join(s->thread, NULL);
+     /* Fall through */
+   case SUPPORTER_IDLE:
+     s->state = SUPPORTER_RUNNING;
+     if (pthread_create(&s->thread, NULL, supporter_run, s) != 0) {
+       perror("pthread_create supporter");
+       exit(1);
+     }
+     supporter_starts++;
+     break;
+  }
+}
+
+/*
+ * Check if one more supporter may run without exceeding the number of
+ * CPUs granted to the supporters (supporter_mutex must be held).
+ */
+static int supporter_budget_left()
+{
+  int n, used = 0;
+
+  if (supporter_cpus == 0)
+    return 1;
+  for (n = 0; n < nb_supporter_groups; n++) {
+    if (supporter_groups[n] != NULL)
+      used += supporter_groups[n]->active;
+  }
+  return used < supporter_cpus;
+}
+
+/*
+ * Resize the pool of a group from the counters sampled during the last
+ * period: add supporters when the abort rate is high (and supporters are
+ * effective), remove them when the group stays uncontended.
+ */
+static void supporter_adjust(supporter_group_t *g, unsigned long commits, unsigned long aborts,
+                             unsigned long helped)
+{
+  unsigned long attempts = commits + aborts;
+
+  if (attempts > 0 && aborts * 100 >= attempts * SUPPORTER_GROW_ABORT_RATE
+      && (g->active == 0 || helped > 0)) {
+    g->low_periods = 0;
+    if (g->active < SUPPORTER_MAX_PER_GROUP && supporter_budget_left()) {
+      g->active++;
+      supporter_start(g, g->active - 1);
+    }
+  } else if (aborts * 100 <= attempts * SUPPORTER_SHRINK_ABORT_RATE
+             && helped * 100 <= attempts * SUPPORTER_SHRINK_HELP_RATE) {
+    if (++g->low_periods >= SUPPORTER_SHRINK_PERIODS && g->active > SUPPORTER_MIN_PER_GROUP) {
+      /* The supporter notices by itself and parks */
+      g->active--;
+      supporter_wake();
+      g->low_periods = 0;
+    }
+  } else {
+    g->low_periods = 0;
+  }
+}
+
+/*
+ * Supervisor thread: periodically samples the per-group statistics of
+ * the workers and resizes the supporter pools.
+ */
+static void *supporter_supervise(void *data)
+{
+  struct timespec deadline;
+  supporter_group_t *g;
+  stm_tx_t *tx;
+  unsigned long commits, aborts, extended, supp_aborts;
+  int n, i;
+
+  pthread_mutex_lock(&supporter_mutex);
+  while (!supporter_stop) {
+    supporter_deadline(&deadline, SUPPORTER_SUPERVISOR_PERIOD);
+    pthread_cond_timedwait(&supporter_cond, &supporter_mutex, &deadline);
+    if (supporter_stop)
+      break;
+    if (supporter_paused || supporter_pool_policy == SUPPORTER_POOL_FIXED)
+      continue;
+    for (n = 0; n < nb_supporter_groups; n++) {
+      if ((g = supporter_groups[n]) == NULL)
+        continue;
+      commits = aborts = extended = supp_aborts = 0;
+      /* Descriptors are never freed while the library runs */
+      for (i = g->base_thread_id; i < g->base_thread_id + g->supported_threads; i++) {
+        if ((tx = (stm_tx_t *)stm_tx_slots[i].tx) == NULL)
+          continue;
+        commits += tx->total_commits;
+        aborts += tx->total_aborts;
+        extended += tx->extended;
+        supp_aborts += tx->aborts_supporter_validate_read;
+      }
+      /* Counters decrease when a worker exits: just resynchronize */
+      if (commits >= g->last_commits && aborts >= g->last_aborts
+          && extended >= g->last_extended && supp_aborts >= g->last_supporter_aborts) {
+        supporter_adjust(g, commits - g->last_commits, aborts - g->last_aborts,
+                         (extended - g->last_extended) + (supp_aborts - g->last_supporter_aborts));
+      }
+      g->last_commits = commits;
+      g->last_aborts = aborts;
+      g->last_extended = extended;
+      g->last_supporter_aborts = supp_aborts;
+    }
+  }
+  pthread_mutex_unlock(&supporter_mutex);
+
+  return NULL;
+}
+
+/*
+ * Start the initial supporters of a group (supporter_mutex must be held).
+ */
+static void supporter_group_start(supporter_group_t *g)
+{
+  g->low_periods = 0;
+  while (g->active < SUPPORTER_INITIAL_PER_GROUP && g->active < SUPPORTER_MAX_PER_GROUP
+         && supporter_budget_left()) {
+    g->active++;
+    supporter_start(g, g->active - 1);
+  }
+}
+
+/*
+ * Start the supervisor if it is not running yet (supporter_mutex must be
+ * held).  The supervisor waits for the mutex before doing anything.
+ */
+static void supporter_supervisor_start()
+{
+#if SUPPORTER_SUPERVISOR_PERIOD > 0
+  if (supervisor_running)
+    return;
+  if (pthread_create(&supervisor_thread, NULL, supporter_supervise, NULL) != 0) {
+    perror("pthread_create supervisor");
+    exit(1);
+  }
+  supervisor_running = 1;
+#endif /* SUPPORTER_SUPERVISOR_PERIOD > 0 */
+}
 
+/*
+ * Return the group supporting a worker slot, creating it (and starting
+ * its supporters) if the slot is the first of its range to register.
+ * Returns NULL if supporters are disabled.
+ */
+static supporter_group_t *supporter_group_join(int slot)
+{
+  supporter_group_t *g;
+  int i, r;
 
-#ifdef IRREVOCABLE_ENABLED
-  if (!tx->irrevocable && ATOMIC_LOAD_ACQ(&irrevocable)) {
-    stm_rollback(tx, STM_ABORT_IRREVOCABLE);
+  if (slot < 0 || supporter_groups == NULL || supporter_ratio == 0)
     return NULL;
+
+  i = slot / supporter_ratio;
+  pthread_mutex_lock(&supporter_mutex);
+  if ((g = supporter_groups[i]) == NULL) {
+    if ((g = (supporter_group_t *)calloc(1, sizeof(supporter_group_t))) == NULL) {
+      perror("calloc");
+      exit(1);
+    }
+    g->base_thread_id = i * supporter_ratio;
+    g->supported_threads = supporter_ratio;
+    if (g->supported_threads > MAX_THREADS - g->base_thread_id)
+      g->supported_threads = MAX_THREADS - g->base_thread_id;
+    for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+      g->supporters[r].group = g;
+      g->supporters[r].rank = r;
+      /* Placed when started (see topo_supporter_cpu()) */
+      g->supporters[r].cpu = -1;
+      g->supporters[r].state = SUPPORTER_IDLE;
+    }
+    /* Supporters of other groups may look at the group right away */
+    ATOMIC_MB_WRITE;
+    supporter_groups[i] = g;
+    if (i >= nb_supporter_groups)
+      nb_supporter_groups = i + 1;
+    if (supporter_running) {
+      supporter_group_start(g);
+      supporter_supervisor_start();
+    }
   }
-#endif /* IRREVOCABLE_ENABLED */
+  pthread_mutex_unlock(&supporter_mutex);
 
-  return w;
+  return g;
 }
 
 /*
- * Store a word-sized value in a unit transaction.
+ * Start the initial supporters of each group and the supervisor.  Groups
+ * created later start their supporters when their first worker joins.
  */
-static inline int stm_unit_write(volatile stm_word_t *addr, stm_word_t value, stm_word_t mask, stm_word_t *timestamp)
+static void supporter_pool_start()
 {
-  volatile stm_word_t *lock;
-  stm_word_t l;
-
-  PRINT_DEBUG2("==> stm_unit_write(a=%p,d=%p-%lu,m=0x%lx)\n",
-               addr, (void *)value, (unsigned long)value, (unsigned long)mask);
+  int i;
 
-  /* Get reference to lock */
-  lock = GET_LOCK(addr);
+  if (supporter_groups == NULL)
+    return;
 
-  /* Try to acquire lock */
- restart:
-  l = ATOMIC_LOAD_ACQ(lock);
-  if (LOCK_GET_OWNED(l)) {
-    /* Locked: wait until lock is free */
-#ifdef WAIT_YIELD
-    sched_yield();
-#endif /* WAIT_YIELD */
-    goto restart;
-  }
-  /* Not locked */
-  if (timestamp != NULL && LOCK_GET_TIMESTAMP(l) > *timestamp) {
-    /* Return current timestamp */
-    *timestamp = LOCK_GET_TIMESTAMP(l);
-    return 0;
+  pthread_mutex_lock(&supporter_mutex);
+  if (supporter_running) {
+    pthread_mutex_unlock(&supporter_mutex);
+    return;
   }
-  /* TODO: would need to store thread ID to be able to kill it (for wait freedom) */
-  if (ATOMIC_CAS_FULL(lock, l, LOCK_UNIT) == 0)
-    goto restart;
-  ATOMIC_STORE(addr, value);
-  /* Update timestamp with newer value (may exceed VERSION_MAX by up to MAX_THREADS) */
-  l = FETCH_INC_CLOCK + 1;
-  if (timestamp != NULL)
-    *timestamp = l;
-  /* Make sure that lock release becomes visible */
-  ATOMIC_STORE_REL(lock, LOCK_SET_TIMESTAMP(l));
-  if (l >= VERSION_MAX) {
-    /* Block all transactions and reset clock (current thread is not in active transaction) */
-    stm_quiesce_barrier(NULL, rollover_clock, NULL);
+  supporter_stop = 0;
+  supporter_running = 1;
+  for (i = 0; i < nb_supporter_groups; i++) {
+    if (supporter_groups[i] != NULL) {
+      supporter_group_start(supporter_groups[i]);
+      supporter_supervisor_start();
+    }
   }
-  return 1;
+  pthread_mutex_unlock(&supporter_mutex);
 }
 
-#ifdef SIGNAL_HANDLER
 /*
- * Catch signal (to emulate non-faulting load).
+ * Stop the supervisor and all supporters, and wait for their threads.
+ * Must not be called by a supporter.
  */
-static void signal_catcher(int sig)
+static void supporter_pool_stop()
 {
-  sigset_t block_signal;
-  stm_tx_t *tx = stm_get_tx();
+  supporter_t *s;
+  int i, r;
 
-  /* A fault might only occur upon a load concurrent with a free (read-after-free) */
-  PRINT_DEBUG("Caught signal: %d\n", sig);
+  if (supporter_groups == NULL)
+    return;
 
-  /* TODO: TX_KILLED should be also allowed */
-  if (tx == NULL || tx->attr.no_retry || GET_STATUS(tx->status) != TX_ACTIVE) {
-    /* There is not much we can do: execution will restart at faulty load */
-    fprintf(stderr, "Error: invalid memory accessed and no longjmp destination\n");
-    exit(1);
+  pthread_mutex_lock(&supporter_mutex);
+  if (!supporter_running) {
+    pthread_mutex_unlock(&supporter_mutex);
+    return;
+  }
+  supporter_stop = 1;
+  pthread_cond_broadcast(&supporter_cond);
+  pthread_mutex_unlock(&supporter_mutex);
+  supporter_wake();
+
+  if (supervisor_running) {
+    pthread_join(supervisor_thread, NULL);
+    supervisor_running = 0;
+  }
+  for (i = 0; i < nb_supporter_groups; i++) {
+    if (supporter_groups[i] == NULL)
+      continue;
+    for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+      s = &supporter_groups[i]->supporters[r];
+      if (s->state != SUPPORTER_IDLE)
+        pthread_join(s->thread, NULL);
+      s->state = SUPPORTER_IDLE;
+    }
+    supporter_groups[i]->active = 0;
   }
 
-# ifdef INTERNAL_STATS
-  tx->aborts_invalid_memory++;
-# endif /* INTERNAL_STATS */
-
-  /* Unblock the signal since there is no return to signal handler */
-  sigemptyset(&block_signal);
-  sigaddset(&block_signal, sig);
-  pthread_sigmask(SIG_UNBLOCK, &block_signal, NULL);
-
-  /* Will cause a longjmp */
-  stm_rollback(tx, STM_ABORT_SIGNAL);
+  pthread_mutex_lock(&supporter_mutex);
+  supporter_running = 0;
+  pthread_mutex_unlock(&supporter_mutex);
 }
-#endif /* SIGNAL_HANDLER */
-
-/* ################################################################### *
- * STM FUNCTIONS
- * ################################################################### */
 
 /*
- * Called once (from main) to initialize STM infrastructure.
+ * Pause the supporters: returns once none of them accesses descriptors,
+ * locks or the clock.  Pauses nest.
  */
+static void supporter_pool_pause()
+{
+  int i, r, busy;
 
-#ifdef SUPPORTER_THREAD
-
-static inline void check_should_abort() {
-	TX_GET;
-
-	if (tx->should_abort && tx->current_run_checked){
-		tx->running_transaction=0;
-		tx->aborts_supporter_validate_read++;
-
-		//if (stm_validate(tx)) {
-		//	tx->error++;
-			//TO_DO
-			//printf("\nerror");
-			//fflush(stdout);
-		//}
+  if (supporter_groups == NULL)
+    return;
 
-		//printf("\n\t\t\tshould_abort - aborted: %i ", tx->aborts_supporter_validate_read);
-		//fflush(stdout);
-        stm_rollback(tx, STM_ABORT_VAL_READ);
-	} else {
-		//extend tx
+  pthread_mutex_lock(&supporter_mutex);
+  supporter_paused++;
+  pthread_cond_broadcast(&supporter_cond);
+  pthread_mutex_unlock(&supporter_mutex);
+  /* Supporters sleeping until the next commit must notice */
+  supporter_wake();
 
+  pthread_mutex_lock(&supporter_mutex);
+  do {
+    busy = 0;
+    for (i = 0; i < nb_supporter_groups; i++) {
+      if (supporter_groups[i] == NULL)
+        continue;
+      for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+        if (supporter_groups[i]->supporters[r].state == SUPPORTER_RUNNING)
+          busy = 1;
+      }
+    }
+    if (busy)
+      pthread_cond_wait(&supporter_cond, &supporter_mutex);
+  } while (busy && !supporter_stop);
+  pthread_mutex_unlock(&supporter_mutex);
+}
 
-		if (tx->end<tx->new_start_timestamp) {
-			tx->end=tx->new_start_timestamp;
-			tx->extended++;
-			//printf("\n\t\textended %i %i ",tx->start, tx->end);
-		}
+/*
+ * Undo one pause.
+ */
+static void supporter_pool_resume()
+{
+  if (supporter_groups == NULL)
+    return;
 
+  pthread_mutex_lock(&supporter_mutex);
+  assert(supporter_paused > 0);
+  if (--supporter_paused == 0)
+    pthread_cond_broadcast(&supporter_cond);
+  pthread_mutex_unlock(&supporter_mutex);
+}
 
-	}
+/*
+ * Collect the statistics of the supporters and free the groups.  The
+ * supporters must have been stopped.
+ */
+static void supporter_groups_free()
+{
+  supporter_t *s;
+  int i, r, p;
+
+  /* Lock order: statistics, then supporters */
+  pthread_mutex_lock(&stm_stats_mutex);
+  pthread_mutex_lock(&supporter_mutex);
+  for (i = 0; i < nb_supporter_groups; i++) {
+    if (supporter_groups[i] == NULL)
+      continue;
+    for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+      s = &supporter_groups[i]->supporters[r];
+      supporter_waits_spin += s->waits_spin;
+      supporter_waits_park += s->waits_park;
+      supporter_parked_time += s->parked_time;
+      supporter_passes += s->passes;
+      supporter_stale_passes += s->stale_passes;
+      supporter_entries += s->entries;
+      for (p = 0; p < NB_SUPPORTER_SCHED; p++) {
+        supporter_sched_validations[p] += s->sched_validations[p];
+        supporter_sched_dooms[p] += s->sched_dooms[p];
+        supporter_sched_wasted[p] += s->sched_wasted[p];
+        supporter_sched_detect_lag[p] += s->sched_detect_lag[p];
+        supporter_sched_detect_time[p] += s->sched_detect_time[p];
+      }
+#ifdef SUPPORTER_WORK_STEALING
+      supporter_steals += s->steals;
+      supporter_steal_attempts += s->steal_attempts;
+#endif /* SUPPORTER_WORK_STEALING */
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+      supporter_validations_parallel += s->validations_parallel;
+      supporter_chunks_helped += s->chunks_helped;
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_COMMIT_LOG
+      supporter_validations_log += s->validations_log;
+      supporter_validations_full += s->validations_full;
+      supporter_log_unlogged += s->log_unlogged;
+      supporter_log_pending += s->log_pending;
+      supporter_log_overrun += s->log_overrun;
+      supporter_log_hits += s->log_hits;
+#endif /* SUPPORTER_COMMIT_LOG */
+#ifdef SUPPORTER_PREACQUIRE
+      supporter_locks_acquired += s->locks_acquired;
+#endif /* SUPPORTER_PREACQUIRE */
+    }
+    free(supporter_groups[i]);
+    supporter_groups[i] = NULL;
+  }
+  nb_supporter_groups = 0;
+  pthread_mutex_unlock(&supporter_mutex);
+  pthread_mutex_unlock(&stm_stats_mutex);
 }
 
-void run_supporter_thread(void * data) {
+/*
+ * Add the counters of a worker to aggregate statistics.
+ */
+static void supporter_stats_add_worker(supporter_stats_t *st, stm_tx_t *tx)
+{
+#ifdef SUPPORTER_THREAD_TIMERS
+  int i;
+#endif /* SUPPORTER_THREAD_TIMERS */
 
-	int i;
-	stm_word_t now=0;
-	//int supporter_thread_id=pthread_self();
-	int main_thread_id=((run_supporter_thread_data_t*) data)->base_thread_id;
- 	int num_tm_threads=((run_supporter_thread_data_t*) data)->num_tm_threads;
+  st->validations += tx->mailbox.validations;
+  st->dooms += tx->aborts_supporter_validate_read;
+  st->extensions += tx->extended;
+  st->self_extensions += tx->self_extended;
+  st->lock_waits += tx->lock_waits;
+  st->lock_wait_aborts += tx->lock_wait_aborts;
+  st->lock_wait_parks += tx->lock_wait_parks;
+#ifdef ATS
+  st->ats_queued += tx->ats_queued;
+#endif /* ATS */
+#ifdef MULTI_VERSION
+  st->mv_reads += tx->mv_reads;
+  st->mv_misses += tx->mv_misses;
+  st->mv_kept += tx->mv_kept;
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+  st->group_batches += tx->group_batches;
+  st->group_commits += tx->group_commits;
+#endif /* GROUP_COMMIT */
+#ifdef SUPPORTER_THREAD_TIMERS
+  for (i = 0; i < SUPPORTER_LATENCY_BUCKETS; i++)
+    st->doom_latency[i] += tx->doom_latency[i];
+  for (i = 0; i < SUPPORTER_LATENCY_BUCKETS; i++)
+    st->lock_wait_latency[i] += tx->lock_wait_latency[i];
+#endif /* SUPPORTER_THREAD_TIMERS */
+}
 
-	//printf("supporter_thread_id %i created, base thread %i\n", supporter_thread_id, main_thread_id );
-	//fflush(stdout);
+/*
+ * Sum the statistics of the threads that have exited and of those still
+ * running.  Counters of running threads are read without
+ * synchronization, hence the result is approximate while they run.
+ */
+static void supporter_stats_collect(supporter_stats_t *st)
+{
+  supporter_t *s;
+  stm_tx_t *tx;
+  int i, r;
+
+  memset(st, 0, sizeof(*st));
+  pthread_mutex_lock(&stm_stats_mutex);
+  st->passes = supporter_passes;
+  st->stale_passes = supporter_stale_passes;
+  st->entries = supporter_entries;
+  st->validations = supporter_validations;
+  st->dooms = aborts_supporter_validate_read;
+  st->extensions = extended;
+  st->self_extensions = self_extended;
+  memcpy(st->doom_latency, supporter_doom_latency, sizeof(st->doom_latency));
+  st->lock_waits = lock_waits;
+  st->lock_wait_aborts = lock_wait_aborts;
+  st->lock_wait_parks = lock_wait_parks;
+#ifdef ATS
+  st->ats_queued = ats_queued;
+#endif /* ATS */
+#ifdef MULTI_VERSION
+  st->mv_reads = mv_reads;
+  st->mv_misses = mv_misses;
+  st->mv_kept = mv_kept;
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+  st->group_batches = group_batches;
+  st->group_commits = group_commits;
+#endif /* GROUP_COMMIT */
+  memcpy(st->lock_wait_latency, lock_wait_latency, sizeof(st->lock_wait_latency));
+  /* Descriptors are never freed while the library runs */
+  for (i = 0; i < MAX_THREADS; i++) {
+    if ((tx = (stm_tx_t *)stm_tx_slots[i].tx) != NULL)
+      supporter_stats_add_worker(st, tx);
+  }
+  if (supporter_groups != NULL) {
+    pthread_mutex_lock(&supporter_mutex);
+    for (i = 0; i < nb_supporter_groups; i++) {
+      if (supporter_groups[i] == NULL)
+        continue;
+      for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+        s = &supporter_groups[i]->supporters[r];
+        st->passes += s->passes;
+        st->stale_passes += s->stale_passes;
+        st->entries += s->entries;
+      }
+    }
+    pthread_mutex_unlock(&supporter_mutex);
+  }
+  pthread_mutex_unlock(&stm_stats_mutex);
+}
 
-	stm_tx_t *stm_tx_pointer;
-	//move this thread on its CPU-core
+/*
+ * Set up the (empty) table of groups and start the pool.
+ */
+static void supporter_pool_init()
+{
+  supporter_stop = 0;
+  supporter_paused = 0;
+  pthread_mutex_init(&supporter_mutex, NULL);
+  pthread_cond_init(&supporter_cond, NULL);
+
+  /* Large enough for one worker per group */
+  if ((supporter_groups = (supporter_group_t **)calloc(MAX_THREADS, sizeof(supporter_group_t *))) == NULL) {
+    perror("calloc");
+    exit(1);
+  }
+  nb_supporter_groups = 0;
 
-	  cpu_set_t *cpuSetMask=(cpu_set_t*)malloc(sizeof(cpu_set_t));
-	  __CPU_ZERO_S(sizeof(cpu_set_t),cpuSetMask);
-	  __CPU_SET_S(main_thread_id*2+1, sizeof(cpu_set_t), cpuSetMask);
-	  // set thread affinity
-	  if (sched_setaffinity(0, sizeof(cpu_set_t), cpuSetMask)!=0) {
-	  	printf("\nsched_setaffinity error - errno: %i ",errno);
-	  }
+  supporter_pool_start();
+}
 
-	//int supporter_thread_ratio=((run_supporter_thread_data_t*) data)->supporter_thread_ratio;
+/*
+ * Stop the supervisor and all supporters, collect their statistics and
+ * release the groups.
+ */
+static void supporter_pool_exit()
+{
+  if (supporter_groups == NULL)
+    return;
 
-	while(1) {
+  supporter_pool_stop();
+  supporter_groups_free();
 
-		while(CLOCK<=now){__asm volatile ("pause" ::: "memory");};
+  free(supporter_groups);
+  supporter_groups = NULL;
+  supporter_paused = 0;
+  pthread_cond_destroy(&supporter_cond);
+  pthread_mutex_destroy(&supporter_mutex);
+}
 
-		for (i=main_thread_id; i<main_thread_id+((run_supporter_thread_data_t*) data)->supported_threads; i++) {
+/*
+ * Change the number of workers per group of supporters.  Groups are
+ * rebuilt, hence no worker may be registered.  Returns 0 on failure.
+ */
+static int supporter_set_ratio(int ratio)
+{
+  int i, running;
 
-			stm_tx_pointer=stm_tx_pointers[i];
-			if (stm_tx_pointer==NULL) continue;
-			if (!stm_tx_pointer->running_transaction || stm_tx_pointer->should_abort) continue;
-			//printf("\nsupporter thread %i is checking thread %i", supporter_thread_id,  i);
-			//fflush(stdout);
+  if (ratio < 0 || ratio > MAX_THREADS)
+    return 0;
+  if (supporter_groups == NULL) {
+    /* Used by the next stm_init() */
+    supporter_ratio = ratio;
+    return 1;
+  }
+  for (i = 0; i < MAX_THREADS; i++) {
+    if (stm_tx_slots[i].tx != NULL)
+      return 0;
+  }
 
-			now=CLOCK;
+  running = supporter_running;
+  supporter_pool_stop();
+  supporter_groups_free();
+  supporter_ratio = ratio;
+  topo_plan(0, supporter_ratio, SUPPORTER_MAX_PER_GROUP, (supporter_ratio > 0 ? supporter_placement : TOPO_PLACE_NONE));
+  if (running)
+    supporter_pool_start();
 
-			if (now<=stm_tx_pointer->end) {
-				//printf("\nnow = stm_tx_pointer->end = %llu", now);
-				continue;
-			}
-			//printf("\nnow: %llu\tstm_tx_pointer->end: %llu", now, stm_tx_pointer->end);
-
-
-			stm_tx_pointer->current_run_checked=1;
-			/*
-			//pthread_spin_lock(&test_spinlock);
-			//int g=_stm_validate(main_stm_tx);
-			//pthread_spin_unlock(&test_spinlock);
-			 */
-
-			if (_stm_validate(stm_tx_pointer)) {
-				stm_tx_pointer->new_start_timestamp = now;
-				//printf("\nCan extend: thread_id %lu from %i to %i ",stm_tx_pointer->thread_id, stm_tx_pointer->end,now);
-				//fflush(stdout);
-			} else {
-				//printf("\nsetting should_abort: time: %i ", now);
-				stm_tx_pointer->should_abort=1;
-				//printf("\set should_abort thread_id: %lu", stm_tx_pointer->thread_id);
-				//fflush(stdout);
-			}
+  return 1;
+}
 
+/*
+ * Apply the supporter settings found in the environment (they override
+ * the compile-time defaults and the parameters set before stm_init()).
+ */
+static void supporter_getenv()
+{
+  static const struct {
+    const char *var;                    /* Environment variable */
+    const char *name;                   /* Parameter */
+    int numeric;                        /* Is the value an integer? */
+  } vars[] = {
+    { "STM_SUPPORTERS_RATIO", "supporter_ratio", 1 },
+    { "STM_SUPPORTERS_CPUS", "supporter_cpus", 1 },
+    { "STM_SUPPORTERS_POLICY", "supporter_policy", 0 },
+    { "STM_SUPPORTERS_PLACEMENT", "supporter_placement", 0 },
+    { "STM_SUPPORTERS_WAIT", "supporter_wait_policy", 0 },
+    { "STM_SUPPORTERS_SPIN_BUDGET", "supporter_spin_budget", 1 },
+    { "STM_SUPPORTERS_SCHEDULE", "supporter_schedule", 0 },
+    { "STM_LOCK_WAIT", "lock_wait_policy", 0 },
+    { "STM_LOCK_SPIN_BUDGET", "lock_spin_budget", 1 },
+#ifdef ATS
+    { "STM_ATS_THRESHOLD", "ats_threshold", 1 },
+#endif /* ATS */
+#if CM == CM_MODULAR
+    { "STM_CM_POLICY", "cm_policy", 0 },
+#endif /* CM == CM_MODULAR */
+  };
+  char *val, *end;
+  int i, v, ok;
 
-		}
-	}
+  for (i = 0; i < (int)(sizeof(vars) / sizeof(vars[0])); i++) {
+    if ((val = getenv(vars[i].var)) == NULL)
+      continue;
+    if (vars[i].numeric) {
+      v = (int)strtol(val, &end, 10);
+      ok = (end != val && *end == '\0' && stm_set_parameter(vars[i].name, &v));
+    } else
+      ok = stm_set_parameter(vars[i].name, val);
+    if (!ok)
+      fprintf(stderr, "Ignoring invalid value of %s: %s\n", vars[i].var, val);
+  }
 }
 
 #endif /* ! SUPPORTER_THREAD */
 
-#ifdef SUPPORTER_THREAD
-void stm_init(int num_tm_threads, int numSupportedThreads)
-#else /* ! SUPPORTER_THREAD */
+/*
+ * Called once (from main) to initialize STM infrastructure.
+ */
 void stm_init()
-#endif
 {
-
-
-#ifdef SIGNAL_HANDLER
+#if defined(SIGNAL_HANDLER) || defined(SUPPORTER_DOOM_SIGNAL)
   struct sigaction act;
-#endif /* SIGNAL_HANDLER */
+#endif /* defined(SIGNAL_HANDLER) || defined(SUPPORTER_DOOM_SIGNAL) */
 
   PRINT_DEBUG("==> stm_init()\n");
 
@@ -1685,29 +5467,23 @@ void stm_init()
     return;
 
 #ifdef SUPPORTER_THREAD
-  //supporter_thread_ratio=sp_ratio;
-  pthread_spin_init(&stm_tx_pointers_spinlock, 0);
+  pthread_mutex_init(&stm_stats_mutex, NULL);
 
-  //pthread_spin_lock(&test_spinlock);
-  memset(stm_tx_pointers,NULL, sizeof(stm_tx_t*)*MAX_THREADS);
+  tx_slot_init();
+  supporter_getenv();
 
-  //printf("supp_threads %i\n", numSupportedThreads);
-  //fflush(stdout);
-  //create #supp_threads  supporter threads
-  int i;
-  for (i=0;i<num_tm_threads;i++) {
-	  if (numSupportedThreads!=0 && i%numSupportedThreads==0) {
-		  run_supporter_thread_data_t* run_supporter_thread_data = malloc(sizeof(run_supporter_thread_data_t));
-		  run_supporter_thread_data->base_thread_id=i;
-		  run_supporter_thread_data->supported_threads=numSupportedThreads;
-		  run_supporter_thread_data->num_tm_threads=num_tm_threads;
-		  pthread_t supporter_thread;
-		  pthread_create(&supporter_thread, NULL, (void *) &run_supporter_thread, (void *) run_supporter_thread_data);
-	  }
-  }
+  /* Place workers and supporters according to the CPU topology (workers
+   * are placed when they register) */
+  topo_init();
+  topo_plan(0, supporter_ratio, SUPPORTER_MAX_PER_GROUP, (supporter_ratio > 0 ? supporter_placement : TOPO_PLACE_NONE));
+
+  /* Supporters are started when the first worker of their group registers */
+  supporter_pool_init();
 
 #endif /* ! SUPPORTER_THREAD */
 
+  validate_init();
+
   PRINT_DEBUG("\tsizeof(word)=%d\n", (int)sizeof(stm_word_t));
 
   PRINT_DEBUG("\tVERSION_MAX=0x%lx\n", (unsigned long)VERSION_MAX);
@@ -1723,6 +5499,16 @@ void stm_init()
 
 
   CLOCK = 0;
+#if CLOCK_SCHEME == CLOCK_NODE
+  memset(clock_nodes, 0, sizeof(clock_nodes));
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
+#ifdef SUPPORTER_COMMIT_LOG
+  commit_log_unlogged_ts = 0;
+  memset((void *)commit_log_index, 0, sizeof(commit_log_index));
+#endif /* SUPPORTER_COMMIT_LOG */
+#ifdef ATS
+  memset((void *)ats_blocks, 0, sizeof(ats_blocks));
+#endif /* ATS */
   stm_quiesce_init();
 
 #ifndef TLS
@@ -1744,6 +5530,16 @@ void stm_init()
     }
   }
 #endif /* SIGNAL_HANDLER */
+#ifdef SUPPORTER_DOOM_SIGNAL
+  /* Catch dooms delivered by the supporters */
+  act.sa_handler = doom_catcher;
+  act.sa_flags = SA_RESTART;
+  sigemptyset(&act.sa_mask);
+  if (sigaction(SUPPORTER_DOOM_SIGNO, &act, NULL) < 0) {
+    perror("sigaction");
+    exit(1);
+  }
+#endif /* SUPPORTER_DOOM_SIGNAL */
   initialized = 1;
 }
 
@@ -1752,6 +5548,12 @@ void stm_init()
  */
 void stm_exit()
 {
+#ifdef SUPPORTER_THREAD
+  const char *dump;
+  FILE *f;
+  int i;
+#endif /* SUPPORTER_THREAD */
+
   PRINT_DEBUG("==> stm_exit()\n");
 
 #ifndef TLS
@@ -1759,22 +5561,92 @@ void stm_exit()
 #endif /* ! TLS */
   stm_quiesce_exit();
 
+#ifdef MULTI_VERSION
+  mv_reset();
+#endif /* MULTI_VERSION */
 #ifdef EPOCH_GC
   gc_exit();
 #endif /* EPOCH_GC */
 
 #ifdef SUPPORTER_THREAD /* SUPPORTER_THREAD */
- printf("\ttotal supporter aborted: %i error: %i ", aborts_supporter_validate_read,error);
- printf("\textended: %i ", extended);
- printf("\ttotal committed: %i ", total_commits);
- printf("\ttotal aborted: %i ", total_aborts);
- printf("\ttotal prepares: %i ", total_prepares);
+  /* Supporters are joined first so that the dump is final */
+  supporter_pool_stop();
+  if ((dump = getenv("STM_STATS_DUMP")) != NULL) {
+    if (strcmp(dump, "-") == 0)
+      stm_dump_stats(stdout);
+    else if ((f = fopen(dump, "w")) == NULL)
+      perror("fopen stats dump");
+    else {
+      stm_dump_stats(f);
+      fclose(f);
+    }
+  }
+  supporter_pool_exit();
+  tx_slot_exit();
+  pthread_mutex_destroy(&stm_stats_mutex);
+  topo_exit();
+
+ printf("\ttotal supporter aborted: %lu error: %lu ", aborts_supporter_validate_read,error);
+ printf("\textended: %lu self extended: %lu ", extended, self_extended);
+ printf("\ttotal committed: %lu ", total_commits);
+ printf("\ttotal aborted: %lu ", total_aborts);
+ printf("\ttotal prepares: %lu ", total_prepares);
+ printf("\tsupporter passes: %lu stale: %lu entries validated: %lu ", supporter_passes, supporter_stale_passes, supporter_entries);
+ printf("\tsupporters started: %i parked: %i retired: %i ", supporter_starts, supporter_parks, supporter_retires);
+ printf("\tsupporter waits (%s): spin: %lu park: %lu wakeups: %lu parked time %f ",
+        supporter_wait_names[supporter_wait_policy], supporter_waits_spin, supporter_waits_park,
+        supporter_wakeups, (float)supporter_parked_time/(float)1000000);
+ printf("\tlock waits (%s): %lu aborts: %lu parks: %lu ",
+        lock_wait_names[lock_wait_policy], lock_waits, lock_wait_aborts, lock_wait_parks);
+#ifdef ATS
+ printf("\tatomic block scheduling (threshold %d): queued: %lu ", ats_threshold, ats_queued);
+#endif /* ATS */
+#ifdef MULTI_VERSION
+ printf("\tsnapshots: old versions read: %lu misses: %lu kept: %lu ", mv_reads, mv_misses, mv_kept);
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+ printf("\tgroup commit: batches: %lu commits: %lu ", group_batches, group_commits);
+#endif /* GROUP_COMMIT */
+#ifdef SUPPORTER_COMMIT_LOG
+ printf("\tsupporter validations: commit log: %lu full: %lu (unlogged: %lu pending: %lu overrun: %lu hits: %lu) ",
+        supporter_validations_log, supporter_validations_full,
+        supporter_log_unlogged, supporter_log_pending, supporter_log_overrun, supporter_log_hits);
+#endif /* SUPPORTER_COMMIT_LOG */
+ printf("\tvalidation lag: avg %f max %lu ",
+        (supporter_validations ? (float)supporter_validation_lag/(float)supporter_validations : 0.0), supporter_validation_lag_max);
+#ifdef SUPPORTER_WORK_STEALING
+ printf("\tsteals: %lu attempts: %lu ", supporter_steals, supporter_steal_attempts);
+#endif /* SUPPORTER_WORK_STEALING */
+#ifdef SUPPORTER_PARALLEL_VALIDATION
+ printf("\tparallel validations: %lu chunks helped: %lu ", supporter_validations_parallel, supporter_chunks_helped);
+#endif /* SUPPORTER_PARALLEL_VALIDATION */
+#ifdef SUPPORTER_PREACQUIRE
+ printf("\tshared lock acquisitions: %lu locks by supporters: %lu ", supporter_preacquired, supporter_locks_acquired);
+#endif /* SUPPORTER_PREACQUIRE */
+#ifdef SUPPORTER_DOOM_SIGNAL
+ printf("\tdoom signals: %lu ", supporter_doom_signals);
+#endif /* SUPPORTER_DOOM_SIGNAL */
+#ifdef SUPPORTER_RO_ASSIST
+ printf("\tsupported read-only commits: %lu ", supporter_ro_supported);
+#endif /* SUPPORTER_RO_ASSIST */
+ for (i = 0; i < NB_SUPPORTER_SCHED; i++) {
+   if (supporter_sched_validations[i] == 0)
+     continue;
+   printf("\tschedule %s: validations %lu wasted %lu dooms %lu detection %f (%f commits) ",
+          supporter_sched_names[i], supporter_sched_validations[i], supporter_sched_wasted[i],
+          supporter_sched_dooms[i],
+          (supporter_sched_dooms[i] ? (float)supporter_sched_detect_time[i]/(float)supporter_sched_dooms[i]/(float)1000000 : 0.0),
+          (supporter_sched_dooms[i] ? (float)supporter_sched_detect_lag[i]/(float)supporter_sched_dooms[i] : 0.0));
+ }
 
 
 #ifdef SUPPORTER_THREAD_TIMERS
-  printf("\ttotal_no_tx_time %f wasted time %f usefull time %f\n",(float)total_no_tx_time/(float)1000000,(float)total_tx_wasted_time/(float)1000000, (float)total_tx_time/(float)1000000);
+  printf("\ttotal_no_tx_time %f wasted time %f (doomed %f) usefull time %f\n",(float)total_no_tx_time/(float)1000000,(float)total_tx_wasted_time/(float)1000000, (float)total_tx_doomed_time/(float)1000000, (float)total_tx_time/(float)1000000);
 #endif /* ! SUPPORTER_THREAD_TIMERS */
 #endif /* ! SUPPORTER_THREAD */
+
+  /* Allow the library to be initialized again */
+  initialized = 0;
 }
 
 
@@ -1785,6 +5657,9 @@ void stm_exit()
 TXTYPE stm_init_thread()
 {
   stm_tx_t *tx;
+#ifdef SUPPORTER_THREAD
+  int slot;
+#endif /* SUPPORTER_THREAD */
 
   PRINT_DEBUG("==> stm_init_thread()\n");
 
@@ -1795,27 +5670,58 @@ TXTYPE stm_init_thread()
   gc_init_thread();
 #endif /* EPOCH_GC */
 
-  /* Allocate descriptor */
-  if ((tx = (stm_tx_t *)malloc(sizeof(stm_tx_t))) == NULL) {
-    perror("malloc tx");
-    exit(1);
+#ifdef SUPPORTER_THREAD
+  /* Claim a registry slot and reuse the descriptor left there, if any */
+  slot = tx_slot_claim();
+  if (slot >= 0 && stm_tx_slots[slot].cache != NULL) {
+    tx = stm_tx_slots[slot].cache;
+    stm_tx_slots[slot].cache = NULL;
+  } else
+#endif /* SUPPORTER_THREAD */
+  {
+    /* Allocate descriptor */
+    if ((tx = (stm_tx_t *)malloc(sizeof(stm_tx_t))) == NULL) {
+      perror("malloc tx");
+      exit(1);
+    }
+    /* Read set */
+    tx->r_set.size = RW_SET_SIZE;
+    stm_allocate_rs_entries(tx, 0);
+#ifdef READ_SET_INDEX
+    set_index_init(&tx->r_set.index);
+#endif /* READ_SET_INDEX */
+    /* Write set */
+    tx->w_set.size = RW_SET_SIZE;
+    stm_allocate_ws_entries(tx, 0);
+#if DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX)
+    set_index_init(&tx->w_set.index);
+#endif /* DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX) */
+#ifdef SUPPORTER_THREAD
+    tx->attempt = 0;
+    tx->mailbox.verdict = 0;
+    tx->mailbox.validator = 0;
+    /* Kept when the descriptor is reused: waiters may still be asleep */
+    tx->release_seq = 0;
+    tx->lock_waiters = 0;
+# ifdef SUPPORTER_COMMIT_LOG
+    tx->clog_head = 0;
+# endif /* SUPPORTER_COMMIT_LOG */
+#endif /* SUPPORTER_THREAD */
   }
   /* Set status (no need for CAS or atomic op) */
   tx->status = TX_IDLE;
-  /* Read set */
-  tx->r_set.nb_entries = 0;
-  tx->r_set.size = RW_SET_SIZE;
-  stm_allocate_rs_entries(tx, 0);
-  /* Write set */
+  stm_rs_reset(&tx->r_set);
   tx->w_set.nb_entries = 0;
-  tx->w_set.size = RW_SET_SIZE;
 #if DESIGN == WRITE_BACK_CTL
   tx->w_set.nb_acquired = 0;
 # ifdef USE_BLOOM_FILTER
-  tx->w_set.bloom = 0;
+  memset(tx->w_set.bloom, 0, sizeof(tx->w_set.bloom));
 # endif /* USE_BLOOM_FILTER */
+# ifdef WRITE_SET_INDEX
+  /* Slots left by the previous thread must not be valid any more */
+  set_index_reset(&tx->w_set.index);
+# endif /* WRITE_SET_INDEX */
 #endif /* DESIGN == WRITE_BACK_CTL */
-  stm_allocate_ws_entries(tx, 0);
   /* Nesting level */
   tx->nesting = 0;
   /* Transaction-specific data */
@@ -1828,6 +5734,19 @@ TXTYPE stm_init_thread()
 #if CM == CM_MODULAR || defined(INTERNAL_STATS) || defined(HYBRID_ASF)
   tx->retries = 0;
 #endif /* CM == CM_MODULAR || defined(INTERNAL_STATS) || defined(HYBRID_ASF) */
+#if CM == CM_DELAY || CM == CM_MODULAR
+  /* Contention manager */
+  tx->c_lock = NULL;
+#endif /* CM == CM_DELAY || CM == CM_MODULAR */
+#if CM == CM_BACKOFF || CM == CM_MODULAR
+  tx->backoff = MIN_BACKOFF;
+  tx->seed = (unsigned long)tx | 1;
+#endif /* CM == CM_BACKOFF || CM == CM_MODULAR */
+#if CM == CM_MODULAR
+  tx->cm_flags = 0;
+  tx->cm_karma = 0;
+  tx->cm_doom_lock = NULL;
+#endif /* CM == CM_MODULAR */
 #ifdef INTERNAL_STATS
   /* Statistics */
   tx->aborts = 0;
@@ -1863,16 +5782,43 @@ TXTYPE stm_init_thread()
 
 #ifdef SUPPORTER_THREAD
   tx->current_thread_terminated=0;
+  tx->supporter_wakeups=0;
+  tx->lock_waits=0;
+  tx->lock_wait_aborts=0;
+  tx->lock_wait_parks=0;
+#ifdef ATS
+  tx->ats_block=NULL;
+  tx->ats_queued=0;
+#endif /* ATS */
+#ifdef MULTI_VERSION
+  tx->mv_snapshot=0;
+  tx->mv_fallback=0;
+  tx->mv_reads=0;
+  tx->mv_misses=0;
+  tx->mv_kept=0;
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+  tx->group_state=GROUP_IDLE;
+  tx->group_batches=0;
+  tx->group_commits=0;
+#endif /* GROUP_COMMIT */
+  tx->mailbox.validations=0;
+  tx->mailbox.validation_lag=0;
+  tx->mailbox.validation_lag_max=0;
+  tx->mailbox.abort_score=0;
+  tx->mailbox.seen_aborts=0;
+# ifdef SUPPORTER_COMMIT_LOG
+  /* The log of a reused descriptor is kept: supporters may be reading it */
+  memset(tx->r_sig, 0, sizeof(tx->r_sig));
+# endif /* SUPPORTER_COMMIT_LOG */
   tx->aborts_supporter_validate_read=0;
   tx->error=0;
   tx->extended=0;
+  tx->self_extended=0;
   tx->total_commits=0;
   tx->total_aborts=0;
   tx->total_prepares=0;
   tx->running_transaction=0;
-  tx->should_abort=0;
-  tx->new_start_timestamp=0;
-  tx->current_run_checked=0;
 
 #ifdef SUPPORTER_THREAD_TIMERS
   tx->first_start_tx_time=0;
@@ -1881,35 +5827,45 @@ TXTYPE stm_init_thread()
   tx->total_no_tx_time=0;
   tx->total_tx_wasted_time=0;
   tx->total_tx_time=0;
+  tx->mailbox.doom_time=0;
+  tx->total_tx_doomed_time=0;
+  memset(tx->doom_latency, 0, sizeof(tx->doom_latency));
+  memset(tx->lock_wait_latency, 0, sizeof(tx->lock_wait_latency));
 #endif /* ! SUPPORTER_THREAD */
-
-  // find the first free location and store thread_tx pointer
-  pthread_spin_lock(&stm_tx_pointers_spinlock);
-  int i=0;
-  while (i<MAX_THREADS) {
-	  if (stm_tx_pointers[i]==NULL) {
-		  stm_tx_pointers[i]=tx;
-		  break;
-	  }
-	  i++;
-  }
-  pthread_spin_unlock(&stm_tx_pointers_spinlock);
-
-//SPOSTARE LA CREAZIONE DEL THREAD SUPPORTER DENTRO TM_INIT
-
-
-  //move this thread on its CPU-core
-
-  cpu_set_t *cpuSetMask=(cpu_set_t*)malloc(sizeof(cpu_set_t));
-  __CPU_ZERO_S(sizeof(cpu_set_t),cpuSetMask);
-  __CPU_SET_S(i*2, sizeof(cpu_set_t), cpuSetMask);
-  // set thread affinity
-  if (sched_setaffinity(0, sizeof(cpu_set_t), cpuSetMask)!=0) {
-  	printf("\nsched_setaffinity error - errno: %i ",errno);
+#ifdef SUPPORTER_PREACQUIRE
+  tx->acq_next=0;
+  tx->acq_chunks=0;
+  tx->acq_gen=0;
+  tx->preacquired=0;
+#endif /* SUPPORTER_PREACQUIRE */
+#ifdef SUPPORTER_DOOM_SIGNAL
+  tx->thread=pthread_self();
+  tx->async_abort=0;
+  tx->mailbox.doom_signals=0;
+#endif /* SUPPORTER_DOOM_SIGNAL */
+
+  tx->ro_logged=0;
+  tx->ro_supported=0;
+
+  /* Register the descriptor (a new generation starts) */
+  tx->slot=slot;
+  tx->group=supporter_group_join(slot);
+  if (slot >= 0) {
+    stm_tx_slots[slot].tx=tx;
+    ATOMIC_FETCH_INC_FULL(&stm_tx_slots[slot].gen);
+
+    /* Move this thread on the CPU planned for its slot */
+    topo_bind(topo_worker_cpu(slot));
   }
 
 
 #endif /* ! SUPPORTER_THREAD */
+#if CLOCK_SCHEME == CLOCK_GV6
+  tx->clock_commits = 0;
+#elif CLOCK_SCHEME == CLOCK_NODE
+  /* Combine commits with the threads of the same node (once placed) */
+  tx->clock_node = &clock_nodes[topo_current_node() % CLOCK_NODES];
+#endif /* CLOCK_SCHEME == CLOCK_NODE */
 
   /* Callbacks */
   if (nb_init_cb != 0) {
@@ -1929,36 +5885,79 @@ void stm_exit_thread(TXPARAM)
 #ifdef EPOCH_GC
   stm_word_t t;
 #endif /* EPOCH_GC */
+#ifdef SUPPORTER_THREAD_TIMERS
+  int i;
+#endif /* SUPPORTER_THREAD_TIMERS */
   TX_GET;
 
   PRINT_DEBUG("==> stm_exit_thread(%p[%lu-%lu])\n", tx, (unsigned long)tx->start, (unsigned long)tx->end);
 
 #ifdef SUPPORTER_THREAD /* SUPPORTER_THREAD */
   tx->current_thread_terminated=1;
-  // find the first free location and store thread_tx pointer
-  pthread_spin_lock(&stm_tx_pointers_spinlock);
-  int i;
-  while (i<MAX_THREADS) {
-	  if (stm_tx_pointers[i]==tx) {
-		  stm_tx_pointers[i]=NULL;
-		  break;
-	  }
-	  i++;
+  if (tx->slot >= 0) {
+#ifdef SUPPORTER_COMMIT_LOG
+    /* Our commit log disappears: supporters must not rely on it */
+    if (tx->clog_head > 0)
+      commit_log_set_unlogged(tx->clog[(tx->clog_head - 1) & (COMMIT_LOG_SIZE - 1)].ts);
+#endif /* SUPPORTER_COMMIT_LOG */
+    /* End the generation, then wait for a supporter that did not notice */
+    stm_tx_slots[tx->slot].tx=NULL;
+    ATOMIC_FETCH_INC_FULL(&stm_tx_slots[tx->slot].gen);
+    while (ATOMIC_LOAD_ACQ(&tx->mailbox.validator) != 0)
+      __asm volatile ("pause" ::: "memory");
+
+    /* Give the thread back the CPUs it could run on */
+    topo_unbind();
   }
 
+   pthread_mutex_lock(&stm_stats_mutex);
+
    aborts_supporter_validate_read+=tx->aborts_supporter_validate_read;
    error+=tx->error;
    extended+=tx->extended;
+   self_extended+=tx->self_extended;
    total_aborts+=tx->total_aborts;
    total_commits+=tx->total_commits;
    total_prepares+=tx->total_prepares;
+   supporter_wakeups+=tx->supporter_wakeups;
+   lock_waits+=tx->lock_waits;
+   lock_wait_aborts+=tx->lock_wait_aborts;
+   lock_wait_parks+=tx->lock_wait_parks;
+#ifdef ATS
+   ats_queued+=tx->ats_queued;
+#endif /* ATS */
+#ifdef MULTI_VERSION
+   mv_reads+=tx->mv_reads;
+   mv_misses+=tx->mv_misses;
+   mv_kept+=tx->mv_kept;
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+   group_batches+=tx->group_batches;
+   group_commits+=tx->group_commits;
+#endif /* GROUP_COMMIT */
+   supporter_ro_supported+=tx->ro_supported;
+   supporter_validations+=tx->mailbox.validations;
+   supporter_validation_lag+=tx->mailbox.validation_lag;
+   if (supporter_validation_lag_max<tx->mailbox.validation_lag_max)
+     supporter_validation_lag_max=tx->mailbox.validation_lag_max;
 #ifdef SUPPORTER_THREAD_TIMERS
    total_no_tx_time+=tx->total_no_tx_time;
    total_tx_wasted_time+=tx->total_tx_wasted_time;
    total_tx_time+=tx->total_tx_time;
+   total_tx_doomed_time+=tx->total_tx_doomed_time;
+   for (i = 0; i < SUPPORTER_LATENCY_BUCKETS; i++)
+     supporter_doom_latency[i]+=tx->doom_latency[i];
+   for (i = 0; i < SUPPORTER_LATENCY_BUCKETS; i++)
+     lock_wait_latency[i]+=tx->lock_wait_latency[i];
 #endif /* ! SUPPORTER_THREAD_TIMERS */
+#ifdef SUPPORTER_PREACQUIRE
+   supporter_preacquired+=tx->preacquired;
+#endif /* SUPPORTER_PREACQUIRE */
+#ifdef SUPPORTER_DOOM_SIGNAL
+   supporter_doom_signals+=tx->mailbox.doom_signals;
+#endif /* SUPPORTER_DOOM_SIGNAL */
 
-   pthread_spin_unlock(&stm_tx_pointers_spinlock);
+   pthread_mutex_unlock(&stm_stats_mutex);
 
 
 #endif /* ! SUPPORTER_THREAD */
@@ -1972,17 +5971,51 @@ void stm_exit_thread(TXPARAM)
 
   stm_quiesce_exit_thread(tx);
 
+#ifdef SUPPORTER_THREAD
+  if (tx->slot >= 0) {
+    /* Leave the descriptor to the next thread that claims the slot */
+    stm_tx_slots[tx->slot].cache = tx;
+    tx_slot_release(tx->slot);
+# ifdef EPOCH_GC
+    gc_exit_thread();
+# endif /* EPOCH_GC */
+  } else
+#endif /* SUPPORTER_THREAD */
+  {
 #ifdef EPOCH_GC
-  t = GET_CLOCK;
-  gc_free(tx->r_set.entries, t);
-  gc_free(tx->w_set.entries, t);
-  gc_free(tx, t);
-  gc_exit_thread();
+    t = GET_CLOCK;
+#ifdef RW_SET_SOA
+    gc_free(tx->r_set.idx, t);
+    gc_free(tx->r_set.versions, t);
+#else /* ! RW_SET_SOA */
+    gc_free(tx->r_set.entries, t);
+#endif /* ! RW_SET_SOA */
+#ifdef READ_SET_INDEX
+    free(tx->r_set.index.slots);
+#endif /* READ_SET_INDEX */
+    gc_free(tx->w_set.entries, t);
+#if DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX)
+    free(tx->w_set.index.slots);
+#endif /* DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX) */
+    gc_free(tx, t);
+    gc_exit_thread();
 #else /* ! EPOCH_GC */
-  free(tx->r_set.entries);
-  free(tx->w_set.entries);
-  free(tx);
+#ifdef RW_SET_SOA
+    free(tx->r_set.idx);
+    free(tx->r_set.versions);
+#else /* ! RW_SET_SOA */
+    free(tx->r_set.entries);
+#endif /* ! RW_SET_SOA */
+#ifdef READ_SET_INDEX
+    free(tx->r_set.index.slots);
+#endif /* READ_SET_INDEX */
+    free(tx->w_set.entries);
+#if DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX)
+    free(tx->w_set.index.slots);
+#endif /* DESIGN == WRITE_BACK_CTL && defined(WRITE_SET_INDEX) */
+    free(tx);
 #endif /* ! EPOCH_GC */
+  }
 
 #ifdef TLS
   thread_tx = NULL;
@@ -2019,6 +6052,11 @@ sigjmp_buf *stm_start(TXPARAMS stm_tx_attr_t *attr)
   tx->attr = (attr == NULL ? default_attributes : *attr);
   tx->ro = tx->attr.read_only; /* TODO ro is a duplicate attribute */
 
+#ifdef ATS
+  /* Serialize with the other instances of a contended atomic block */
+  ats_schedule(tx);
+#endif /* ATS */
+
   /* Initialize transaction descriptor */
 
 
@@ -2042,17 +6080,19 @@ int stm_commit(TXPARAM)
 {
 
 #ifdef SUPPORTER_THREAD
+# ifdef SUPPORTER_DOOM_SIGNAL
+  stm_get_tx()->async_abort=0;
+# endif /* SUPPORTER_DOOM_SIGNAL */
   check_should_abort();
 #endif /* ! SUPPORTER_THREAD */
 
 	//pthread_spin_lock(&test_spinlock);
 	//pthread_spin_unlock(&test_spinlock);
 
-  w_entry_t *w;
   stm_word_t t;
-  int i;
 #if DESIGN == WRITE_BACK_CTL
-  stm_word_t l, value;
+  w_entry_t *w;
+  stm_word_t l;
 #endif /* DESIGN == WRITE_BACK_CTL */
   TX_GET;
 
@@ -2061,7 +6101,7 @@ int stm_commit(TXPARAM)
 
 #ifdef SUPPORTER_THREAD
   tx->running_transaction=0;
-	/*if (tx->should_abort && tx->current_run_checked) {
+	/*if (supporter_doomed(tx)) {
 		//print_readset(tx);
 		printf("\n\t\t\tshould_abort: %i ", GET_CLOCK);
 		fflush(stdout);
@@ -2098,6 +6138,24 @@ int stm_commit(TXPARAM)
     return 0;
   }
 # endif /* IRREVOCABLE_ENABLED */
+# ifdef SUPPORTER_PREACQUIRE
+  if (tx->w_set.nb_entries >= SUPPORTER_PREACQUIRE_THRESHOLD
+#  ifdef IRREVOCABLE_ENABLED
+      /* Irrevocable transactions must not fail acquiring their locks */
+      && !tx->irrevocable
+#  endif /* IRREVOCABLE_ENABLED */
+      ) {
+    /* Share lock acquisition with the supporters */
+    if (!supporter_acquire_parallel(tx)) {
+#  ifdef INTERNAL_STATS
+      tx->aborts_locked_write++;
+#  endif /* INTERNAL_STATS */
+      stm_rollback(tx, STM_ABORT_WW_CONFLICT);
+      return 0;
+    }
+    goto locks_acquired;
+  }
+# endif /* SUPPORTER_PREACQUIRE */
   /* Acquire locks (in reverse order) */
   w = tx->w_set.entries + tx->w_set.nb_entries;
   do {
@@ -2111,7 +6169,9 @@ int stm_commit(TXPARAM)
         /* Yes: ignore */
         continue;
       }
-      /* Conflict: CM kicks in */
+      /* Conflict: CM kicks in (the owner may wait for one of our locks) */
+      if (stm_cm_conflict(tx, w->lock, l, STM_ABORT_WW_CONFLICT, 1))
+        goto restart;
       /* Abort self */
 # ifdef INTERNAL_STATS
       tx->aborts_locked_write++;
@@ -2127,6 +6187,9 @@ int stm_commit(TXPARAM)
     w->version = LOCK_GET_TIMESTAMP(l);
     tx->w_set.nb_acquired++;
   } while (w > tx->w_set.entries);
+# ifdef SUPPORTER_PREACQUIRE
+ locks_acquired:
+# endif /* SUPPORTER_PREACQUIRE */
 #endif /* DESIGN == WRITE_BACK_CTL */
 
 #ifdef IRREVOCABLE_ENABLED
@@ -2148,10 +6211,29 @@ int stm_commit(TXPARAM)
     stm_rollback(tx, STM_ABORT_IRREVOCABLE);
     return 0;
   }
-# endif /* ! IRREVOCABLE_IMPROVED */
-#endif /* IRREVOCABLE_ENABLED */ 
+# endif /* ! IRREVOCABLE_IMPROVED */
+#endif /* IRREVOCABLE_ENABLED */ 
+#ifdef GROUP_COMMIT
+# ifdef IRREVOCABLE_ENABLED
+  /* Irrevocable transactions commit alone */
+  if (tx->irrevocable)
+    goto commit_alone;
+# endif /* IRREVOCABLE_ENABLED */
+  /* Share the clock increment and the write-back with concurrent commits */
+  if (!stm_group_commit(tx)) {
+# ifdef INTERNAL_STATS
+    tx->aborts_validate_commit++;
+# endif /* INTERNAL_STATS */
+    stm_rollback(tx, STM_ABORT_VALIDATE);
+    return 0;
+  }
+  goto written_back;
+# ifdef IRREVOCABLE_ENABLED
+ commit_alone:
+# endif /* IRREVOCABLE_ENABLED */
+#endif /* GROUP_COMMIT */
   /* Get commit timestamp (may exceed VERSION_MAX by up to MAX_THREADS) */
-  t = FETCH_INC_CLOCK + 1;
+  t = clock_commit(tx);
  // printf("\n\t\t\tclock after: %i ", GET_CLOCK);
 #ifdef IRREVOCABLE_ENABLED
   if (tx->irrevocable)
@@ -2159,11 +6241,15 @@ int stm_commit(TXPARAM)
 #endif /* IRREVOCABLE_ENABLED */
 
   /* Try to validate (only if a concurrent transaction has committed since tx->start) */
-  if (tx->start != t - 1 && !stm_validate(tx)) {
+  if (!CLOCK_EXCLUSIVE(tx, t) && !stm_validate(tx)) {
     /* Cannot commit */
 #ifdef INTERNAL_STATS
     tx->aborts_validate_commit++;
 #endif /* INTERNAL_STATS */
+#ifdef SUPPORTER_COMMIT_LOG
+    /* The timestamp released no lock (old versions are restored) */
+    commit_log_publish(t, 0, COMMIT_LOG_NONE);
+#endif /* SUPPORTER_COMMIT_LOG */
     stm_rollback(tx, STM_ABORT_VALIDATE);
     return 0;
   }
@@ -2174,28 +6260,29 @@ int stm_commit(TXPARAM)
 
 
 
-  /* Install new versions, drop locks and set new timestamp */
-  w = tx->w_set.entries;
-  for (i = tx->w_set.nb_entries; i > 0; i--, w++) {
-    /* TODO stm_release */
-    //if (w->addr == NULL)
-      //continue;
-    if (w->mask == ~(stm_word_t)0) {
-      ATOMIC_STORE(w->addr, w->value);
-    } else if (w->mask != 0) {
-      value = (ATOMIC_LOAD(w->addr) & ~w->mask) | (w->value & w->mask);
-      ATOMIC_STORE(w->addr, value);
-    }
-    /* Only drop lock for last covered address in write set (cannot be "no drop") */
-    if (!w->no_drop)
-      ATOMIC_STORE_REL(w->lock, LOCK_SET_TIMESTAMP(t));
-  }
+  stm_write_back(tx, t);
+#ifdef SUPPORTER_COMMIT_LOG
+  if (tx->slot >= 0)
+    commit_log_publish(t, tx->clog_head, tx->slot);
+#endif /* SUPPORTER_COMMIT_LOG */
+#ifdef GROUP_COMMIT
+ written_back:
+#endif /* GROUP_COMMIT */
 
+#ifdef SUPPORTER_THREAD
+  /* Wake up parked supporters (the clock increment was a full barrier) */
+  if (ATOMIC_LOAD(&supporter_sleepers) > 0) {
+    supporter_wake();
+    tx->supporter_wakeups++;
+  }
+#endif /* SUPPORTER_THREAD */
 
  end:
 
 #ifdef SUPPORTER_THREAD
   tx->total_commits++;
+  if (tx->ro_logged)
+    tx->ro_supported++;
 #endif /* ! SUPPORTER_THREAD */
 
 #ifdef SUPPORTER_THREAD_TIMERS
@@ -2213,6 +6300,22 @@ int stm_commit(TXPARAM)
 #if CM == CM_MODULAR || defined(INTERNAL_STATS)
   tx->retries = 0;
 #endif /* CM == CM_MODULAR || defined(INTERNAL_STATS) */
+#if CM == CM_BACKOFF || CM == CM_MODULAR
+  /* Reset backoff */
+  tx->backoff = MIN_BACKOFF;
+#endif /* CM == CM_BACKOFF || CM == CM_MODULAR */
+#if CM == CM_MODULAR
+  tx->cm_karma = 0;
+  tx->cm_doom_lock = NULL;
+#endif /* CM == CM_MODULAR */
+#ifdef ATS
+  ats_update(tx, 0);
+  ats_release(tx);
+#endif /* ATS */
+#ifdef MULTI_VERSION
+  mv_end(tx);
+  tx->mv_fallback = 0;
+#endif /* MULTI_VERSION */
 
 
 #ifdef HYBRID_ASF
@@ -2279,7 +6382,7 @@ void stm_store(TXPARAMS volatile stm_word_t *addr, stm_word_t value)
   TX_GET;
 
 #ifdef SUPPORTER_THREAD
-  //check_should_abort();
+  check_should_abort();
 #endif /* ! SUPPORTER_THREAD */
 
 #ifdef IRREVOCABLE_ENABLED
@@ -2299,6 +6402,10 @@ void stm_store2(TXPARAMS volatile stm_word_t *addr, stm_word_t value, stm_word_t
 {
   TX_GET;
 
+#ifdef SUPPORTER_THREAD
+  check_should_abort();
+#endif /* ! SUPPORTER_THREAD */
+
 #ifdef IRREVOCABLE_ENABLED
   if (unlikely(((tx->irrevocable & 0x08) != 0))) {
     /* Serial irrevocable mode: direct access to memory */
@@ -2312,6 +6419,84 @@ void stm_store2(TXPARAMS volatile stm_word_t *addr, stm_word_t value, stm_word_t
   stm_write(tx, addr, value, mask);
 }
 
+/*
+ * Called by the CURRENT thread to check if its transaction has been
+ * found invalid by a supporter (and abort it if so).
+ */
+void stm_poll(TXPARAM)
+{
+#ifdef SUPPORTER_THREAD
+  TX_GET;
+
+  if (tx->nesting > 0)
+    check_should_abort();
+#endif /* SUPPORTER_THREAD */
+}
+
+/*
+ * Called by the CURRENT thread to allow or forbid asynchronous aborts of
+ * its transaction.
+ */
+int stm_async_abort(TXPARAMS int enable)
+{
+#ifdef SUPPORTER_DOOM_SIGNAL
+  TX_GET;
+  int prev;
+
+  prev = tx->async_abort;
+  if (tx->nesting == 0)
+    return prev;
+  tx->async_abort = enable;
+  if (enable) {
+    /* The supporter may have doomed us before it could signal */
+    ATOMIC_MB_FULL;
+    check_should_abort();
+  }
+  return prev;
+#else /* ! SUPPORTER_DOOM_SIGNAL */
+  return 0;
+#endif /* ! SUPPORTER_DOOM_SIGNAL */
+}
+
+#ifdef SUPPORTER_THREAD
+/*
+ * Called by the application to start the supporter threads (after they
+ * have been stopped).
+ */
+void stm_supporters_start()
+{
+  supporter_pool_start();
+}
+
+/*
+ * Called by the application to stop the supporter threads and wait for
+ * them to terminate.
+ */
+void stm_supporters_stop()
+{
+  supporter_pool_stop();
+}
+
+/*
+ * Called by the application to suspend the supporter threads (e.g.,
+ * around a sequential phase).  Returns once no supporter accesses the
+ * descriptors any more.
+ */
+void stm_supporters_pause()
+{
+  supporter_pool_pause();
+}
+
+/*
+ * Called by the application to resume the supporter threads after
+ * stm_supporters_pause().
+ */
+void stm_supporters_resume()
+{
+  supporter_pool_resume();
+}
+#endif /* SUPPORTER_THREAD */
+
 /*
  * Called by the CURRENT thread to inquire about the status of a transaction.
  */
@@ -2401,6 +6586,82 @@ int stm_get_stats(TXPARAMS const char *name, void *val)
     *(unsigned int *)val = tx->ro;
     return 1;
   }
+#ifdef SUPPORTER_THREAD
+  if (strcmp("supporter_validations", name) == 0) {
+    *(unsigned long *)val = tx->mailbox.validations;
+    return 1;
+  }
+  if (strcmp("supporter_dooms", name) == 0) {
+    *(unsigned long *)val = tx->aborts_supporter_validate_read;
+    return 1;
+  }
+  if (strcmp("supporter_extensions", name) == 0) {
+    *(unsigned long *)val = tx->extended;
+    return 1;
+  }
+  if (strcmp("supporter_self_extensions", name) == 0) {
+    *(unsigned long *)val = tx->self_extended;
+    return 1;
+  }
+# ifdef SUPPORTER_THREAD_TIMERS
+  if (strcmp("supporter_doom_latency", name) == 0) {
+    /* Array of SUPPORTER_LATENCY_BUCKETS counters */
+    memcpy(val, tx->doom_latency, sizeof(tx->doom_latency));
+    return 1;
+  }
+# endif /* SUPPORTER_THREAD_TIMERS */
+  if (strcmp("lock_waits", name) == 0) {
+    *(unsigned long *)val = tx->lock_waits;
+    return 1;
+  }
+  if (strcmp("lock_wait_aborts", name) == 0) {
+    *(unsigned long *)val = tx->lock_wait_aborts;
+    return 1;
+  }
+  if (strcmp("lock_wait_parks", name) == 0) {
+    *(unsigned long *)val = tx->lock_wait_parks;
+    return 1;
+  }
+  if (strcmp("ats_queued", name) == 0) {
+# ifdef ATS
+    *(unsigned long *)val = tx->ats_queued;
+# else /* ! ATS */
+    *(unsigned long *)val = 0;
+# endif /* ! ATS */
+    return 1;
+  }
+# ifdef MULTI_VERSION
+  if (strcmp("mv_reads", name) == 0) {
+    *(unsigned long *)val = tx->mv_reads;
+    return 1;
+  }
+  if (strcmp("mv_misses", name) == 0) {
+    *(unsigned long *)val = tx->mv_misses;
+    return 1;
+  }
+  if (strcmp("mv_kept", name) == 0) {
+    *(unsigned long *)val = tx->mv_kept;
+    return 1;
+  }
+# endif /* MULTI_VERSION */
+# ifdef GROUP_COMMIT
+  if (strcmp("group_batches", name) == 0) {
+    *(unsigned long *)val = tx->group_batches;
+    return 1;
+  }
+  if (strcmp("group_commits", name) == 0) {
+    *(unsigned long *)val = tx->group_commits;
+    return 1;
+  }
+# endif /* GROUP_COMMIT */
+# ifdef SUPPORTER_THREAD_TIMERS
+  if (strcmp("lock_wait_latency", name) == 0) {
+    /* Array of SUPPORTER_LATENCY_BUCKETS counters */
+    memcpy(val, tx->lock_wait_latency, sizeof(tx->lock_wait_latency));
+    return 1;
+  }
+# endif /* SUPPORTER_THREAD_TIMERS */
+#endif /* SUPPORTER_THREAD */
 #ifdef INTERNAL_STATS
   if (strcmp("nb_aborts", name) == 0) {
     *(unsigned long *)val = tx->aborts;
@@ -2461,6 +6722,205 @@ int stm_get_stats(TXPARAMS const char *name, void *val)
   return 0;
 }
 
+#ifdef SUPPORTER_THREAD
+/*
+ * Return aggregate statistics about the supporters (and the workers they
+ * help), including threads still running.
+ */
+int stm_get_supporter_stats(const char *name, void *val)
+{
+  supporter_stats_t st;
+
+  if (!initialized)
+    return 0;
+  supporter_stats_collect(&st);
+
+  if (strcmp("supporter_passes", name) == 0) {
+    *(unsigned long *)val = st.passes;
+    return 1;
+  }
+  if (strcmp("supporter_stale_passes", name) == 0) {
+    *(unsigned long *)val = st.stale_passes;
+    return 1;
+  }
+  if (strcmp("supporter_validations", name) == 0) {
+    *(unsigned long *)val = st.validations;
+    return 1;
+  }
+  if (strcmp("supporter_entries", name) == 0) {
+    *(unsigned long *)val = st.entries;
+    return 1;
+  }
+  if (strcmp("supporter_dooms", name) == 0) {
+    *(unsigned long *)val = st.dooms;
+    return 1;
+  }
+  if (strcmp("supporter_extensions", name) == 0) {
+    *(unsigned long *)val = st.extensions;
+    return 1;
+  }
+  if (strcmp("supporter_self_extensions", name) == 0) {
+    *(unsigned long *)val = st.self_extensions;
+    return 1;
+  }
+  if (strcmp("supporter_doom_latency", name) == 0) {
+    /* Array of SUPPORTER_LATENCY_BUCKETS counters */
+    memcpy(val, st.doom_latency, sizeof(st.doom_latency));
+    return 1;
+  }
+  if (strcmp("lock_waits", name) == 0) {
+    *(unsigned long *)val = st.lock_waits;
+    return 1;
+  }
+  if (strcmp("lock_wait_aborts", name) == 0) {
+    *(unsigned long *)val = st.lock_wait_aborts;
+    return 1;
+  }
+  if (strcmp("lock_wait_parks", name) == 0) {
+    *(unsigned long *)val = st.lock_wait_parks;
+    return 1;
+  }
+  if (strcmp("lock_wait_latency", name) == 0) {
+    /* Array of SUPPORTER_LATENCY_BUCKETS counters */
+    memcpy(val, st.lock_wait_latency, sizeof(st.lock_wait_latency));
+    return 1;
+  }
+  if (strcmp("ats_queued", name) == 0) {
+    *(unsigned long *)val = st.ats_queued;
+    return 1;
+  }
+  if (strcmp("mv_reads", name) == 0) {
+    *(unsigned long *)val = st.mv_reads;
+    return 1;
+  }
+  if (strcmp("mv_misses", name) == 0) {
+    *(unsigned long *)val = st.mv_misses;
+    return 1;
+  }
+  if (strcmp("mv_kept", name) == 0) {
+    *(unsigned long *)val = st.mv_kept;
+    return 1;
+  }
+  if (strcmp("group_batches", name) == 0) {
+    *(unsigned long *)val = st.group_batches;
+    return 1;
+  }
+  if (strcmp("group_commits", name) == 0) {
+    *(unsigned long *)val = st.group_commits;
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Print a histogram on the current line of a dump.
+ */
+static void stm_dump_histogram(FILE *f, const char *key, const unsigned long *h)
+{
+  int i;
+
+  fprintf(f, "%s", key);
+  for (i = 0; i < SUPPORTER_LATENCY_BUCKETS; i++)
+    fprintf(f, " %lu", h[i]);
+  fprintf(f, "\n");
+}
+
+/*
+ * Dump the supporter statistics, one "key value..." pair per line.  Keys
+ * and their order are stable: new keys are only ever appended to a
+ * section.
+ */
+void stm_dump_stats(FILE *f)
+{
+  supporter_stats_t st;
+  supporter_t *s;
+  stm_tx_t *tx;
+  char key[64];
+  int i, r;
+
+  if (!initialized)
+    return;
+  supporter_stats_collect(&st);
+
+  fprintf(f, "stats.version 1\n");
+  fprintf(f, "stats.latency_buckets %d\n", SUPPORTER_LATENCY_BUCKETS);
+  fprintf(f, "global.passes %lu\n", st.passes);
+  fprintf(f, "global.stale_passes %lu\n", st.stale_passes);
+  fprintf(f, "global.validations %lu\n", st.validations);
+  fprintf(f, "global.entries %lu\n", st.entries);
+  fprintf(f, "global.dooms %lu\n", st.dooms);
+  fprintf(f, "global.extensions %lu\n", st.extensions);
+  fprintf(f, "global.self_extensions %lu\n", st.self_extensions);
+  stm_dump_histogram(f, "global.doom_latency", st.doom_latency);
+  fprintf(f, "global.lock_waits %lu\n", st.lock_waits);
+  fprintf(f, "global.lock_wait_aborts %lu\n", st.lock_wait_aborts);
+  fprintf(f, "global.lock_wait_parks %lu\n", st.lock_wait_parks);
+  stm_dump_histogram(f, "global.lock_wait_latency", st.lock_wait_latency);
+  fprintf(f, "global.ats_queued %lu\n", st.ats_queued);
+  fprintf(f, "global.mv_reads %lu\n", st.mv_reads);
+  fprintf(f, "global.mv_misses %lu\n", st.mv_misses);
+  fprintf(f, "global.mv_kept %lu\n", st.mv_kept);
+  fprintf(f, "global.group_batches %lu\n", st.group_batches);
+  fprintf(f, "global.group_commits %lu\n", st.group_commits);
+
+  /* Running workers */
+  for (i = 0; i < MAX_THREADS; i++) {
+    if ((tx = (stm_tx_t *)stm_tx_slots[i].tx) == NULL)
+      continue;
+    fprintf(f, "worker.%d.commits %lu\n", i, tx->total_commits);
+    fprintf(f, "worker.%d.aborts %lu\n", i, tx->total_aborts);
+    fprintf(f, "worker.%d.validations %lu\n", i, tx->mailbox.validations);
+    fprintf(f, "worker.%d.dooms %lu\n", i, tx->aborts_supporter_validate_read);
+    fprintf(f, "worker.%d.extensions %lu\n", i, tx->extended);
+    fprintf(f, "worker.%d.self_extensions %lu\n", i, tx->self_extended);
+#ifdef SUPPORTER_THREAD_TIMERS
+    snprintf(key, sizeof(key), "worker.%d.doom_latency", i);
+    stm_dump_histogram(f, key, tx->doom_latency);
+#endif /* SUPPORTER_THREAD_TIMERS */
+    fprintf(f, "worker.%d.lock_waits %lu\n", i, tx->lock_waits);
+    fprintf(f, "worker.%d.lock_wait_aborts %lu\n", i, tx->lock_wait_aborts);
+    fprintf(f, "worker.%d.lock_wait_parks %lu\n", i, tx->lock_wait_parks);
+#ifdef SUPPORTER_THREAD_TIMERS
+    snprintf(key, sizeof(key), "worker.%d.lock_wait_latency", i);
+    stm_dump_histogram(f, key, tx->lock_wait_latency);
+#endif /* SUPPORTER_THREAD_TIMERS */
+#ifdef ATS
+    fprintf(f, "worker.%d.ats_queued %lu\n", i, tx->ats_queued);
+#endif /* ATS */
+#ifdef MULTI_VERSION
+    fprintf(f, "worker.%d.mv_reads %lu\n", i, tx->mv_reads);
+    fprintf(f, "worker.%d.mv_misses %lu\n", i, tx->mv_misses);
+    fprintf(f, "worker.%d.mv_kept %lu\n", i, tx->mv_kept);
+#endif /* MULTI_VERSION */
+#ifdef GROUP_COMMIT
+    fprintf(f, "worker.%d.group_batches %lu\n", i, tx->group_batches);
+    fprintf(f, "worker.%d.group_commits %lu\n", i, tx->group_commits);
+#endif /* GROUP_COMMIT */
+  }
+
+  /* Supporters (by group and rank) */
+  if (supporter_groups != NULL) {
+    pthread_mutex_lock(&supporter_mutex);
+    for (i = 0; i < nb_supporter_groups; i++) {
+      if (supporter_groups[i] == NULL)
+        continue;
+      for (r = 0; r < SUPPORTER_MAX_PER_GROUP; r++) {
+        s = &supporter_groups[i]->supporters[r];
+        if (s->state == SUPPORTER_IDLE && s->passes == 0)
+          continue;
+        snprintf(key, sizeof(key), "supporter.%d.%d", i, r);
+        fprintf(f, "%s.passes %lu\n", key, s->passes);
+        fprintf(f, "%s.stale_passes %lu\n", key, s->stale_passes);
+        fprintf(f, "%s.validations %lu\n", key, s->validations);
+        fprintf(f, "%s.entries %lu\n", key, s->entries);
+      }
+    }
+    pthread_mutex_unlock(&supporter_mutex);
+  }
+  fflush(f);
+}
+#endif /* SUPPORTER_THREAD */
+
 /*
  * Return STM parameters.
  */
@@ -2470,14 +6930,72 @@ int stm_get_parameter(const char *name, void *val)
     *(const char **)val = cm_names[CM];
     return 1;
   }
+#if CM == CM_MODULAR
+  if (strcmp("cm_policy", name) == 0) {
+    *(const char **)val = cm_policy_names[cm_policy];
+    return 1;
+  }
+#endif /* CM == CM_MODULAR */
   if (strcmp("design", name) == 0) {
     *(const char **)val = design_names[DESIGN];
     return 1;
   }
+  if (strcmp("clock_scheme", name) == 0) {
+    *(const char **)val = clock_names[CLOCK_SCHEME];
+    return 1;
+  }
   if (strcmp("initial_rw_set_size", name) == 0) {
     *(int *)val = RW_SET_SIZE;
     return 1;
   }
+  if (strcmp("validation_kernel", name) == 0) {
+    *(const char **)val = validate_kernel_names[validate_kernel];
+    return 1;
+  }
+#ifdef SUPPORTER_THREAD
+  if (strcmp("supporter_ratio", name) == 0) {
+    *(int *)val = supporter_ratio;
+    return 1;
+  }
+  if (strcmp("supporter_cpus", name) == 0) {
+    *(int *)val = supporter_cpus;
+    return 1;
+  }
+  if (strcmp("supporter_policy", name) == 0) {
+    *(const char **)val = supporter_pool_names[supporter_pool_policy];
+    return 1;
+  }
+  if (strcmp("supporter_placement", name) == 0) {
+    *(const char **)val = topo_policy_name(supporter_placement);
+    return 1;
+  }
+  if (strcmp("supporter_wait_policy", name) == 0) {
+    *(const char **)val = supporter_wait_names[supporter_wait_policy];
+    return 1;
+  }
+  if (strcmp("supporter_spin_budget", name) == 0) {
+    *(int *)val = supporter_spin_budget;
+    return 1;
+  }
+  if (strcmp("supporter_schedule", name) == 0) {
+    *(const char **)val = supporter_sched_names[supporter_sched_policy];
+    return 1;
+  }
+  if (strcmp("lock_wait_policy", name) == 0) {
+    *(const char **)val = lock_wait_names[lock_wait_policy];
+    return 1;
+  }
+  if (strcmp("lock_spin_budget", name) == 0) {
+    *(int *)val = lock_spin_budget;
+    return 1;
+  }
+# ifdef ATS
+  if (strcmp("ats_threshold", name) == 0) {
+    *(int *)val = ats_threshold;
+    return 1;
+  }
+# endif /* ATS */
+#endif /* SUPPORTER_THREAD */
 
 #ifdef COMPILE_FLAGS
   if (strcmp("compile_flags", name) == 0) {
@@ -2493,6 +7011,121 @@ int stm_get_parameter(const char *name, void *val)
  */
 int stm_set_parameter(const char *name, void *val)
 {
+  if (strcmp("validation_kernel", name) == 0) {
+    int k;
+    for (k = VALIDATE_SCALAR; k <= VALIDATE_AVX512; k++) {
+      if (strcmp(validate_kernel_names[k], (const char *)val) == 0)
+        return validate_set_kernel(k);
+    }
+    return 0;
+  }
+#ifdef SUPPORTER_THREAD
+  if (strcmp("supporter_ratio", name) == 0) {
+    /* Fails if workers are registered */
+    return supporter_set_ratio(*(int *)val);
+  }
+  if (strcmp("supporter_cpus", name) == 0) {
+    /* Running supporters are not stopped when the limit decreases */
+    if (*(int *)val < 0)
+      return 0;
+    supporter_cpus = *(int *)val;
+    return 1;
+  }
+  if (strcmp("supporter_policy", name) == 0) {
+    int p;
+    for (p = SUPPORTER_POOL_FIXED; p <= SUPPORTER_POOL_ADAPTIVE; p++) {
+      if (strcmp(supporter_pool_names[p], (const char *)val) == 0) {
+#if SUPPORTER_SUPERVISOR_PERIOD == 0
+        /* No supervisor to resize the pools */
+        if (p == SUPPORTER_POOL_ADAPTIVE)
+          return 0;
+#endif /* SUPPORTER_SUPERVISOR_PERIOD == 0 */
+        supporter_pool_policy = p;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  if (strcmp("supporter_placement", name) == 0) {
+    /* Only effective from the next stm_init() (or change of ratio) */
+    int p = topo_policy((const char *)val);
+    if (p < 0)
+      return 0;
+    supporter_placement = p;
+    return 1;
+  }
+  if (strcmp("supporter_wait_policy", name) == 0) {
+    int p;
+    for (p = SUPPORTER_WAIT_SPIN; p <= SUPPORTER_WAIT_PARK; p++) {
+      if (strcmp(supporter_wait_names[p], (const char *)val) == 0) {
+        supporter_wait_policy = p;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  if (strcmp("supporter_spin_budget", name) == 0) {
+    if (*(int *)val < 0)
+      return 0;
+    supporter_spin_budget = *(int *)val;
+    return 1;
+  }
+  if (strcmp("supporter_schedule", name) == 0) {
+    int p;
+    for (p = SUPPORTER_SCHED_RR; p < NB_SUPPORTER_SCHED; p++) {
+      if (strcmp(supporter_sched_names[p], (const char *)val) == 0) {
+        supporter_sched_policy = p;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  if (strcmp("lock_wait_policy", name) == 0) {
+    int p;
+    for (p = LOCK_WAIT_SPIN; p <= LOCK_WAIT_OWNER; p++) {
+      if (strcmp(lock_wait_names[p], (const char *)val) == 0) {
+        lock_wait_policy = p;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  if (strcmp("lock_spin_budget", name) == 0) {
+    if (*(int *)val < 0)
+      return 0;
+    lock_spin_budget = *(int *)val;
+    return 1;
+  }
+# ifdef ATS
+  if (strcmp("ats_threshold", name) == 0) {
+    /* Intensities range from 0 to ATS_ONE (0 = never serialize) */
+    if (*(int *)val < 0 || *(int *)val > ATS_ONE)
+      return 0;
+    ats_threshold = *(int *)val;
+    return 1;
+  }
+# endif /* ATS */
+#endif /* SUPPORTER_THREAD */
+#if CM == CM_MODULAR
+  if (strcmp("cm_policy", name) == 0) {
+    int p;
+    /* Custom policies are set with "cm_function" */
+    for (p = CM_POLICY_SUICIDE; p < CM_POLICY_CUSTOM; p++) {
+      if (strcasecmp(cm_policy_names[p], (const char *)val) == 0) {
+        cm_policy = p;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  if (strcmp("cm_function", name) == 0) {
+    if (val == NULL)
+      return 0;
+    cm_function = (int (*)(struct stm_tx *, struct stm_tx *, int))val;
+    cm_policy = CM_POLICY_CUSTOM;
+    return 1;
+  }
+#endif /* CM == CM_MODULAR */
   return 0;
 }
 
@@ -2801,9 +7434,6 @@ int stm_set_conflict_cb(void (*on_conflict)(stm_tx_t *tx1, stm_tx_t *tx2))
 #ifdef IRREVOCABLE_ENABLED
 int stm_set_irrevocable(TXPARAMS int serial)
 {
-# if CM == CM_MODULAR
-  stm_word_t t;
-# endif /* CM == CM_MODULAR */
   TX_GET;
 
   if (!IS_ACTIVE(tx->status) && serial != -1) {
@@ -3173,14 +7803,6 @@ sigjmp_buf *tm_start(TXPARAMS stm_tx_attr_t *attr)
 {
   return stm_start(TXARGS attr);
 }
-# if CM == CM_MODULAR
-   /* We might still abort if we cannot set status (e.g., we are being killed) */
-    t = tx->status;
-    if (GET_STATUS(t) != TX_ACTIVE || ATOMIC_CAS_FULL(&tx->status, t, t + (TX_IRREVOCABLE - TX_ACTIVE)) == 0) {
-      stm_rollback(tx, STM_ABORT_KILLED);
-      return 0;
-    }
-# endif /* CM == CM_MODULAR */
 stm_word_t tm_load(TXPARAMS volatile stm_word_t *addr)
 {
   return stm_load(TXARGS addr);
@@ -0,0 +1,606 @@
+/*
+ * File:
+ *   topology.c
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   CPU topology discovery and thread placement.
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif /* ! _GNU_SOURCE */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "topology.h"
+
+/* ################################################################### *
+ * DEFINES
+ * ################################################################### */
+
+#define TOPO_MAX_CPUS                   CPU_SETSIZE
+#define TOPO_MAX_NODES                  64
+#define TOPO_SYSFS_CPU                  "/sys/devices/system/cpu"
+#define TOPO_SYSFS_NODE                 "/sys/devices/system/node"
+
+enum {                                  /* Distance between two CPUs */
+  TOPO_SAME_CPU = 0,
+  TOPO_SAME_CORE = 1,
+  TOPO_SAME_L2 = 2,
+  TOPO_SAME_NODE = 3,
+  TOPO_REMOTE = 4
+};
+
+#ifdef DEBUG
+/* Note: stdio is thread-safe */
+# define PRINT_DEBUG(...)               printf(__VA_ARGS__); fflush(NULL)
+#else /* ! DEBUG */
+# define PRINT_DEBUG(...)
+#endif /* ! DEBUG */
+
+/* ################################################################### *
+ * TYPES
+ * ################################################################### */
+
+typedef struct topo_cpu {               /* Usable hardware thread */
+  int id;                               /* Operating system identifier */
+  int core;                             /* Lowest CPU identifier of the physical core */
+  int l2;                               /* Lowest CPU identifier sharing the L2 cache */
+  int node;                             /* NUMA node */
+  int load;                             /* Number of threads placed on this CPU */
+} topo_cpu_t;
+
+static topo_cpu_t topo_cpus[TOPO_MAX_CPUS];
+static int topo_nb = 0;                 /* Number of usable CPUs */
+static int topo_initialized = 0;
+static cpu_set_t topo_allowed;          /* CPUs of the process (kept across topo_exit()) */
+static int topo_allowed_known = 0;
+
+static __thread cpu_set_t topo_saved;   /* Affinity of the CURRENT thread before topo_bind() */
+static __thread int topo_bound = 0;
+
+static int topo_place_policy = TOPO_PLACE_NONE;
+static int topo_group_size = 0;         /* Number of workers per supporter (0 if none) */
+static int *topo_workers = NULL;        /* Worker slot => CPU index */
+static int topo_nb_workers = 0;
+static int topo_nb_ranks = 1;           /* Number of supporters per group */
+static int *topo_supporters = NULL;     /* Supporter group * ranks + rank => CPU index */
+static int topo_nb_supporters = 0;
+
+static pthread_mutex_t topo_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *topo_policy_names[] = {
+  /* 0 */ "none",
+  /* 1 */ "smt",
+  /* 2 */ "l2",
+  /* 3 */ "numa"
+};
+
+/* ################################################################### *
+ * STATIC
+ * ################################################################### */
+
+/*
+ * Read an integer from a sysfs file (return 0 if unavailable).
+ */
+static int topo_read_int(const char *path, int *val)
+{
+  FILE *f;
+  int ok;
+
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  ok = (fscanf(f, "%d", val) == 1);
+  fclose(f);
+  return ok;
+}
+
+/*
+ * Parse a sysfs CPU list (e.g., "0-3,8-11") and mark the CPUs it contains.
+ */
+static int topo_read_list(const char *path, char *mark)
+{
+  FILE *f;
+  char buf[4096], *s, *e;
+  long lo, hi;
+
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  if (fgets(buf, sizeof(buf), f) == NULL) {
+    fclose(f);
+    return 0;
+  }
+  fclose(f);
+  memset(mark, 0, TOPO_MAX_CPUS);
+  for (s = buf; *s != '\0' && *s != '\n'; s = e) {
+    lo = hi = strtol(s, &e, 10);
+    if (e == s)
+      break;
+    if (*e == '-')
+      hi = strtol(e + 1, &e, 10);
+    for (; lo <= hi && lo < TOPO_MAX_CPUS; lo++)
+      mark[lo] = 1;
+    if (*e == ',')
+      e++;
+  }
+  return 1;
+}
+
+/*
+ * Return the lowest CPU in a sysfs CPU list (or -1).
+ */
+static int topo_read_first(const char *path)
+{
+  char mark[TOPO_MAX_CPUS];
+  int i;
+
+  if (!topo_read_list(path, mark))
+    return -1;
+  for (i = 0; i < TOPO_MAX_CPUS; i++) {
+    if (mark[i])
+      return i;
+  }
+  return -1;
+}
+
+/*
+ * Find the lowest CPU sharing the L2 cache of a given CPU.
+ */
+static int topo_read_l2(int cpu)
+{
+  char path[256];
+  int i, level;
+
+  for (i = 0; ; i++) {
+    snprintf(path, sizeof(path), TOPO_SYSFS_CPU "/cpu%d/cache/index%d/level", cpu, i);
+    if (!topo_read_int(path, &level))
+      return -1;
+    if (level == 2) {
+      snprintf(path, sizeof(path), TOPO_SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list", cpu, i);
+      return topo_read_first(path);
+    }
+  }
+}
+
+/*
+ * Sort CPUs so that close hardware threads are neighbors.
+ */
+static int topo_compare(const void *a, const void *b)
+{
+  const topo_cpu_t *ca = (const topo_cpu_t *)a;
+  const topo_cpu_t *cb = (const topo_cpu_t *)b;
+
+  if (ca->node != cb->node)
+    return ca->node - cb->node;
+  if (ca->l2 != cb->l2)
+    return ca->l2 - cb->l2;
+  if (ca->core != cb->core)
+    return ca->core - cb->core;
+  return ca->id - cb->id;
+}
+
+/*
+ * Distance between two CPUs (indexes in the CPU table).
+ */
+static inline int topo_distance(int a, int b)
+{
+  if (a == b)
+    return TOPO_SAME_CPU;
+  if (topo_cpus[a].core == topo_cpus[b].core)
+    return TOPO_SAME_CORE;
+  if (topo_cpus[a].l2 == topo_cpus[b].l2)
+    return TOPO_SAME_L2;
+  if (topo_cpus[a].node == topo_cpus[b].node)
+    return TOPO_SAME_NODE;
+  return TOPO_REMOTE;
+}
+
+/*
+ * Number of threads placed on the physical core of a CPU.
+ */
+static inline int topo_core_load(int c)
+{
+  int i, load = 0;
+
+  for (i = 0; i < topo_nb; i++) {
+    if (topo_cpus[i].core == topo_cpus[c].core)
+      load += topo_cpus[i].load;
+  }
+  return load;
+}
+
+/*
+ * Choose a CPU for a worker: least loaded hardware thread on the least
+ * loaded core, as close as possible to the anchor (if any).
+ */
+static int topo_pick_worker(int anchor)
+{
+  int i, best = -1, d, bd = 0, cl, bcl = 0;
+
+  for (i = 0; i < topo_nb; i++) {
+    cl = topo_core_load(i);
+    d = (anchor < 0 ? 0 : topo_distance(anchor, i));
+    if (best < 0 ||
+        topo_cpus[i].load < topo_cpus[best].load ||
+        (topo_cpus[i].load == topo_cpus[best].load && (cl < bcl || (cl == bcl && d < bd)))) {
+      best = i;
+      bcl = cl;
+      bd = d;
+    }
+  }
+  if (best >= 0)
+    topo_cpus[best].load++;
+  return best;
+}
+
+/*
+ * Choose a CPU for a supporter close to the worker it validates.  The
+ * policy gives the preferred level of the cache hierarchy; wider levels
+ * are only used if no free CPU is found at the preferred level.  Unless
+ * the supporter may share a CPU, only free CPUs up to the NUMA node of
+ * the worker are considered.
+ */
+static int topo_pick_supporter(int worker, int policy, int share)
+{
+  int i, level, d, best = -1, bk = 0, k;
+
+  if (worker < 0)
+    return -1;
+  /* Look for a free CPU, widening the search level if needed */
+  for (level = policy; level <= (share ? TOPO_REMOTE : TOPO_SAME_NODE); level++) {
+    for (i = 0; i < topo_nb; i++) {
+      d = topo_distance(worker, i);
+      if (d == TOPO_SAME_CPU || d > level || topo_cpus[i].load != 0)
+        continue;
+      if (best < 0 || d < topo_distance(worker, best))
+        best = i;
+    }
+    if (best >= 0)
+      goto found;
+  }
+  if (!share)
+    return -1;
+  /* Oversubscribed: share the least loaded CPU, preferably at the requested level */
+  for (i = 0; i < topo_nb; i++) {
+    d = topo_distance(worker, i);
+    if (d == TOPO_SAME_CPU)
+      continue;
+    k = (d > policy ? TOPO_MAX_CPUS : 0) + topo_cpus[i].load * (TOPO_REMOTE + 1) + d;
+    if (best < 0 || k < bk) {
+      best = i;
+      bk = k;
+    }
+  }
+  if (best < 0)
+    return -1;
+ found:
+  topo_cpus[best].load++;
+  return best;
+}
+
+/*
+ * Grow a placement array so that it covers a given index.
+ */
+static int *topo_grow(int *array, int *nb, int idx)
+{
+  int i, n = *nb;
+
+  if (idx < n)
+    return array;
+  if ((array = (int *)realloc(array, (idx + 1) * sizeof(int))) == NULL) {
+    perror("realloc placement");
+    exit(1);
+  }
+  for (i = n; i <= idx; i++)
+    array[i] = -2;                      /* Not placed yet */
+  *nb = idx + 1;
+  return array;
+}
+
+/*
+ * Place worker slot (lock must be held).
+ */
+static int topo_place_worker(int slot)
+{
+  int anchor = -1, i;
+
+  topo_workers = topo_grow(topo_workers, &topo_nb_workers, slot);
+  if (topo_workers[slot] == -2) {
+    /* Keep workers of the same supporter group close to each other */
+    if (topo_group_size > 0 && slot % topo_group_size != 0)
+      anchor = topo_place_worker(slot - slot % topo_group_size);
+    topo_workers[slot] = topo_pick_worker(anchor);
+    if (topo_group_size > 0 && slot % topo_group_size == 0) {
+      /* Reserve the CPU of the first supporter before other workers of
+       * the group are placed (it shares a CPU if none is free) */
+      i = slot / topo_group_size * topo_nb_ranks;
+      topo_supporters = topo_grow(topo_supporters, &topo_nb_supporters, i + topo_nb_ranks - 1);
+      topo_supporters[i] = topo_pick_supporter(topo_workers[slot], topo_place_policy, 1);
+    }
+  }
+  return topo_workers[slot];
+}
+
+/*
+ * Compute the CPUs the process may run on: the online CPUs allowed by the
+ * affinity of the thread that initializes the library for the first
+ * time.  Later initializations reuse this set, since the affinity of the
+ * calling thread may then be that of a pinned worker.
+ */
+static void topo_read_allowed()
+{
+  cpu_set_t affinity;
+  char mark[TOPO_MAX_CPUS];
+  int i, n;
+
+  if (topo_allowed_known)
+    return;
+
+  if (!topo_read_list(TOPO_SYSFS_CPU "/online", mark)) {
+    /* Assume the first CPUs are online */
+    memset(mark, 0, sizeof(mark));
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    for (i = 0; i < n && i < TOPO_MAX_CPUS; i++)
+      mark[i] = 1;
+  }
+  CPU_ZERO(&affinity);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &affinity) != 0) {
+    /* Assume all online CPUs are usable */
+    for (i = 0; i < TOPO_MAX_CPUS; i++)
+      CPU_SET(i, &affinity);
+  }
+  CPU_ZERO(&topo_allowed);
+  for (i = 0; i < TOPO_MAX_CPUS; i++) {
+    if (mark[i] && CPU_ISSET(i, &affinity))
+      CPU_SET(i, &topo_allowed);
+  }
+  if (CPU_COUNT(&topo_allowed) == 0)
+    topo_allowed = affinity;
+  topo_allowed_known = 1;
+}
+
+/* ################################################################### *
+ * FUNCTIONS
+ * ################################################################### */
+
+/*
+ * Discover the CPUs the process may run on and their topology.
+ */
+void topo_init()
+{
+  char path[256], mark[TOPO_MAX_CPUS];
+  int i, n, v;
+
+  if (topo_initialized)
+    return;
+
+  topo_read_allowed();
+
+  topo_nb = 0;
+  for (i = 0; i < TOPO_MAX_CPUS; i++) {
+    if (!CPU_ISSET(i, &topo_allowed))
+      continue;
+    topo_cpus[topo_nb].id = i;
+    /* Physical core (identified by its first hardware thread) */
+    snprintf(path, sizeof(path), TOPO_SYSFS_CPU "/cpu%d/topology/thread_siblings_list", i);
+    if ((v = topo_read_first(path)) < 0)
+      v = i;
+    topo_cpus[topo_nb].core = v;
+    /* L2 cache (private to the core if unknown) */
+    if ((v = topo_read_l2(i)) < 0)
+      v = topo_cpus[topo_nb].core;
+    topo_cpus[topo_nb].l2 = v;
+    topo_cpus[topo_nb].node = 0;
+    topo_cpus[topo_nb].load = 0;
+    topo_nb++;
+  }
+
+  /* NUMA nodes */
+  for (n = 0; n < TOPO_MAX_NODES; n++) {
+    snprintf(path, sizeof(path), TOPO_SYSFS_NODE "/node%d/cpulist", n);
+    if (!topo_read_list(path, mark))
+      continue;
+    for (i = 0; i < topo_nb; i++) {
+      if (mark[topo_cpus[i].id])
+        topo_cpus[i].node = n;
+    }
+  }
+
+  qsort(topo_cpus, topo_nb, sizeof(topo_cpu_t), topo_compare);
+
+  for (i = 0; i < topo_nb; i++) {
+    PRINT_DEBUG("\tcpu %d: core=%d l2=%d node=%d\n", topo_cpus[i].id,
+                topo_cpus[i].core, topo_cpus[i].l2, topo_cpus[i].node);
+  }
+
+  topo_initialized = 1;
+}
+
+/*
+ * Forget placement decisions.
+ */
+void topo_exit()
+{
+  pthread_mutex_lock(&topo_mutex);
+  free(topo_workers);
+  free(topo_supporters);
+  topo_workers = topo_supporters = NULL;
+  topo_nb_workers = topo_nb_supporters = 0;
+  topo_initialized = 0;
+  pthread_mutex_unlock(&topo_mutex);
+}
+
+/*
+ * Number of CPUs usable by the process.
+ */
+int topo_nb_cpus()
+{
+  return topo_nb;
+}
+
+/*
+ * Return the placement policy with the given name (or -1).
+ */
+int topo_policy(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(topo_policy_names) / sizeof(topo_policy_names[0])); i++) {
+    if (strcmp(topo_policy_names[i], name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+/*
+ * Return the name of a placement policy.
+ */
+const char *topo_policy_name(int policy)
+{
+  assert(policy >= TOPO_PLACE_NONE && policy <= TOPO_PLACE_NUMA);
+  return topo_policy_names[policy];
+}
+
+/*
+ * Compute the placement of the first workers and of their first
+ * supporter.  Worker slots beyond the ones planned here, and the other
+ * supporters of each group (up to nb_ranks), are placed on demand.
+ */
+void topo_plan(int nb_workers, int group_size, int nb_ranks, int policy)
+{
+  int i;
+
+  pthread_mutex_lock(&topo_mutex);
+  for (i = 0; i < topo_nb; i++)
+    topo_cpus[i].load = 0;
+  topo_nb_workers = topo_nb_supporters = 0;
+  topo_place_policy = policy;
+  topo_group_size = group_size;
+  topo_nb_ranks = (nb_ranks > 0 ? nb_ranks : 1);
+  if (policy != TOPO_PLACE_NONE) {
+    for (i = 0; i < nb_workers; i++)
+      topo_place_worker(i);
+  }
+  pthread_mutex_unlock(&topo_mutex);
+}
+
+/*
+ * Return the CPU of a worker slot (or -1 if the thread should not be pinned).
+ */
+int topo_worker_cpu(int slot)
+{
+  int c;
+
+  if (topo_place_policy == TOPO_PLACE_NONE)
+    return -1;
+  pthread_mutex_lock(&topo_mutex);
+  c = topo_place_worker(slot);
+  pthread_mutex_unlock(&topo_mutex);
+  return (c < 0 ? -1 : topo_cpus[c].id);
+}
+
+/*
+ * Return the CPU of the supporter of a given rank in the group starting
+ * at a given worker slot (or -1 if the thread should not be pinned).
+ * The first supporter has a CPU reserved with the first worker of the
+ * group.  The others are placed when first asked for, once the workers
+ * have taken their CPUs: they get a free CPU as close to the group as the
+ * NUMA node, or are not pinned if there is none (rather than sharing the
+ * CPU of a worker).  A CPU stays reserved for its rank until the next
+ * plan, so that a supporter that is retired and started again is placed
+ * on the same CPU.
+ */
+int topo_supporter_cpu(int base_slot, int rank)
+{
+  int c, i;
+
+  if (topo_place_policy == TOPO_PLACE_NONE || topo_group_size == 0 || rank >= topo_nb_ranks)
+    return -1;
+  pthread_mutex_lock(&topo_mutex);
+  topo_place_worker(base_slot);
+  i = base_slot / topo_group_size * topo_nb_ranks + rank;
+  if (topo_supporters[i] == -2)
+    topo_supporters[i] = topo_pick_supporter(topo_workers[base_slot], topo_place_policy, 0);
+  c = topo_supporters[i];
+  pthread_mutex_unlock(&topo_mutex);
+  return (c < 0 ? -1 : topo_cpus[c].id);
+}
+
+/*
+ * Return the NUMA node of the CPU the CURRENT thread runs on (0 if
+ * unknown).
+ */
+int topo_current_node()
+{
+  int i, cpu;
+
+  if ((cpu = sched_getcpu()) < 0)
+    return 0;
+  for (i = 0; i < topo_nb; i++) {
+    if (topo_cpus[i].id == cpu)
+      return topo_cpus[i].node;
+  }
+  return 0;
+}
+
+/*
+ * Pin the CURRENT thread to a CPU (no effect if negative).  The affinity
+ * of the thread is saved the first time, for topo_unbind().
+ */
+int topo_bind(int cpu)
+{
+  cpu_set_t set;
+
+  if (cpu < 0)
+    return 1;
+  if (!topo_bound) {
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &topo_saved) != 0) {
+      perror("sched_getaffinity");
+      return 0;
+    }
+  }
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+    perror("sched_setaffinity");
+    return 0;
+  }
+  topo_bound = 1;
+  return 1;
+}
+
+/*
+ * Give the CURRENT thread back the affinity it had before topo_bind()
+ * (no effect if it was not pinned).
+ */
+int topo_unbind()
+{
+  if (!topo_bound)
+    return 1;
+  topo_bound = 0;
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &topo_saved) != 0) {
+    perror("sched_setaffinity");
+    return 0;
+  }
+  return 1;
+}
@@ -0,0 +1,57 @@
+/*
+ * File:
+ *   topology.h
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   CPU topology discovery and thread placement.
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _TOPOLOGY_H_
+# define _TOPOLOGY_H_
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+enum {                                  /* Supporter placement policies */
+  TOPO_PLACE_NONE = 0,                  /* Do not pin threads */
+  TOPO_PLACE_SMT = 1,                   /* SMT sibling of the supported worker */
+  TOPO_PLACE_L2 = 2,                    /* Core sharing the L2 cache of the supported worker */
+  TOPO_PLACE_NUMA = 3                   /* Core on the NUMA node of the supported worker */
+};
+
+void topo_init();
+void topo_exit();
+
+int topo_nb_cpus();
+
+int topo_policy(const char *name);
+const char *topo_policy_name(int policy);
+
+void topo_plan(int nb_workers, int group_size, int nb_ranks, int policy);
+
+int topo_worker_cpu(int slot);
+int topo_supporter_cpu(int base_slot, int rank);
+int topo_current_node();
+
+int topo_bind(int cpu);
+int topo_unbind();
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* _TOPOLOGY_H_ */
@@ -0,0 +1,94 @@
+/*
+ * File:
+ *   verdict.h
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   Encoding of the verdicts published by the supporters in the mailbox
+ *   of a worker, and rules deciding whether a verdict applies to the
+ *   current attempt of its transaction.
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VERDICT_H_
+# define _VERDICT_H_
+
+# include "stm.h"
+
+# if __SIZEOF_POINTER__ < 8
+#  error "Verdicts require 64-bit words"
+# endif /* __SIZEOF_POINTER__ < 8 */
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/* The verdict of the supporters on an attempt of a transaction is
+ * published with a single store: doomed bit, attempt tag, number of read
+ * set entries validated and extension of the snapshot beyond the start
+ * timestamp.  Counts and spans that do not fit are clamped, which is safe
+ * (the worker validates the remaining entries, or extends less).  Needs
+ * 64-bit words. */
+# define VERDICT_TAG_BITS                16
+# define VERDICT_COUNT_BITS              24
+# define VERDICT_SPAN_BITS               23
+# define VERDICT_FIELD(v, shift, bits)   (((v) >> (shift)) & (((stm_word_t)1 << (bits)) - 1))
+# define VERDICT_DOOMED(v)               ((v) & 1)
+# define VERDICT_TAG(v)                  VERDICT_FIELD(v, 1, VERDICT_TAG_BITS)
+# define VERDICT_COUNT(v)                VERDICT_FIELD(v, 1 + VERDICT_TAG_BITS, VERDICT_COUNT_BITS)
+# define VERDICT_SPAN(v)                 VERDICT_FIELD(v, 1 + VERDICT_TAG_BITS + VERDICT_COUNT_BITS, VERDICT_SPAN_BITS)
+# define VERDICT(attempt, count, span, doomed) \
+  ((stm_word_t)(doomed) \
+   | VERDICT_FIELD((stm_word_t)(attempt), 0, VERDICT_TAG_BITS) << 1 \
+   | (stm_word_t)(count) << (1 + VERDICT_TAG_BITS) \
+   | (stm_word_t)(span) << (1 + VERDICT_TAG_BITS + VERDICT_COUNT_BITS))
+# define VERDICT_COUNT_MAX               (((stm_word_t)1 << VERDICT_COUNT_BITS) - 1)
+# define VERDICT_SPAN_MAX                (((stm_word_t)1 << VERDICT_SPAN_BITS) - 1)
+
+/*
+ * Does verdict v apply to attempt?  Verdicts on older attempts are
+ * ignored.
+ */
+static inline int verdict_current(stm_word_t v, stm_word_t attempt)
+{
+  return VERDICT_TAG(v) == VERDICT_FIELD(attempt, 0, VERDICT_TAG_BITS);
+}
+
+/*
+ * Does verdict v doom attempt?
+ */
+static inline int verdict_dooms(stm_word_t v, stm_word_t attempt)
+{
+  return VERDICT_DOOMED(v) && verdict_current(v, attempt);
+}
+
+/*
+ * Verdict the worker must store before starting attempt, or 0 if the
+ * mailbox can be left as is.  When the tag wraps around, the verdict of
+ * an attempt 2^VERDICT_TAG_BITS earlier could still be in the mailbox and
+ * would match: it is replaced by a verdict on the previous attempt, which
+ * never matches before the tag wraps around again.
+ */
+static inline stm_word_t verdict_reset(stm_word_t attempt)
+{
+  if (VERDICT_FIELD(attempt, 0, VERDICT_TAG_BITS) != 0)
+    return 0;
+  return VERDICT(attempt - 1, 0, 0, 0);
+}
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* _VERDICT_H_ */
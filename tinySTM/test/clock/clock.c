@@ -0,0 +1,243 @@
+/*
+ * File:
+ *   clock.c
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   Checks of the commit timestamps given by the clock scheme, and
+ *   throughput of small update transactions on private data, which only
+ *   contend on the global clock, for an increasing number of threads.
+ *   Run it with each CLOCK_SCHEME to check and compare the schemes.
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifdef NDEBUG
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "stm.h"
+
+#define DEFAULT_DURATION                1000
+#define DEFAULT_THREADS                 8
+#define CACHELINE                       64
+#define TX_WRITES                       4
+#define CHECK_THREADS                   4
+#define CHECK_COMMITS                   20000
+
+typedef struct slot {                   /* Private data of a thread */
+  volatile stm_word_t data[TX_WRITES * CACHELINE / sizeof(stm_word_t)];
+  volatile unsigned long commits;
+  volatile unsigned long aborts;
+} __attribute__((aligned(CACHELINE))) slot_t;
+
+static slot_t *slots;
+static volatile int stop;
+static pthread_barrier_t barrier;
+static volatile stm_word_t shared[CACHELINE / sizeof(stm_word_t)] __attribute__((aligned(CACHELINE)));
+
+/*
+ * Each commit also increments a shared counter.  The version of the lock
+ * of its private data is the timestamp of the last commit of the thread:
+ * it must grow with each commit.  The increments of the counter must not
+ * be lost, even when concurrent commits share a timestamp.
+ */
+static void *checker(void *arg)
+{
+  slot_t *s = (slot_t *)arg;
+  stm_word_t last = 0, t;
+  int i;
+
+  stm_init_thread();
+  pthread_barrier_wait(&barrier);
+  for (i = 0; i < CHECK_COMMITS; i++) {
+    stm_tx_attr_t attr = { 0, 0 };
+    sigjmp_buf *e = stm_start(&attr);
+    if (e != NULL)
+      sigsetjmp(*e, 0);
+    stm_store(&s->data[0], stm_load(&s->data[0]) + 1);
+    stm_store(&shared[0], stm_load(&shared[0]) + 1);
+    stm_commit();
+    stm_unit_load(&s->data[0], &t);
+    if (t <= last) {
+      fprintf(stderr, "ERROR: commit timestamp %lu after %lu\n", (unsigned long)t, (unsigned long)last);
+      exit(1);
+    }
+    last = t;
+  }
+  stm_exit_thread();
+  return NULL;
+}
+
+static void check_monotonic()
+{
+  pthread_t threads[CHECK_THREADS];
+  int i;
+
+  shared[0] = 0;
+  pthread_barrier_init(&barrier, NULL, CHECK_THREADS);
+  for (i = 0; i < CHECK_THREADS; i++) {
+    slots[i].data[0] = 0;
+    if (pthread_create(&threads[i], NULL, checker, &slots[i]) != 0) {
+      perror("pthread_create");
+      exit(1);
+    }
+  }
+  for (i = 0; i < CHECK_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    assert(slots[i].data[0] == CHECK_COMMITS);
+  }
+  pthread_barrier_destroy(&barrier);
+  assert(shared[0] == CHECK_THREADS * CHECK_COMMITS);
+}
+
+/*
+ * A transaction reads a location that is then overwritten by a commit,
+ * so that with the lazy schemes the commit of the transaction gets the
+ * timestamp right after its start.  Only with CLOCK_GV1 may such a
+ * commit skip validation: in all schemes the first attempt must abort.
+ */
+static void check_exclusive()
+{
+  static volatile int attempts;
+  stm_word_t v;
+
+  attempts = 0;
+  stm_init_thread();
+  {
+    stm_tx_attr_t attr = { 0, 0 };
+    sigjmp_buf *e = stm_start(&attr);
+    if (e != NULL)
+      sigsetjmp(*e, 0);
+    v = stm_load(&slots[0].data[0]);
+    if (attempts++ == 0)
+      stm_unit_store(&slots[0].data[0], v + 1, NULL);
+    stm_store(&slots[0].data[CACHELINE / sizeof(stm_word_t)], v);
+    stm_commit();
+  }
+  stm_exit_thread();
+  assert(attempts == 2);
+  assert(slots[0].data[CACHELINE / sizeof(stm_word_t)] == slots[0].data[0]);
+}
+
+static void *worker(void *arg)
+{
+  slot_t *s = (slot_t *)arg;
+  stm_word_t v;
+  int i;
+
+  stm_init_thread();
+  pthread_barrier_wait(&barrier);
+  while (!stop) {
+    stm_tx_attr_t attr = { 0, 0 };
+    sigjmp_buf *e = stm_start(&attr);
+    /* Count the restarts (the statistics of the library need INTERNAL_STATS) */
+    if (e != NULL && sigsetjmp(*e, 0) != 0)
+      s->aborts++;
+    /* One location per lock (locks cover 32 bytes by default) */
+    for (i = 0; i < TX_WRITES; i++) {
+      v = stm_load(&s->data[i * CACHELINE / sizeof(stm_word_t)]);
+      stm_store(&s->data[i * CACHELINE / sizeof(stm_word_t)], v + 1);
+    }
+    stm_commit();
+    s->commits++;
+  }
+  stm_exit_thread();
+  return NULL;
+}
+
+static void run(int n, int duration)
+{
+  struct timeval start, end;
+  pthread_t *threads;
+  unsigned long commits = 0, aborts = 0;
+  int i;
+
+  if ((threads = (pthread_t *)malloc(n * sizeof(pthread_t))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  stop = 0;
+  pthread_barrier_init(&barrier, NULL, n + 1);
+  for (i = 0; i < n; i++) {
+    slots[i].commits = slots[i].aborts = 0;
+    if (pthread_create(&threads[i], NULL, worker, &slots[i]) != 0) {
+      perror("pthread_create");
+      exit(1);
+    }
+  }
+  pthread_barrier_wait(&barrier);
+  gettimeofday(&start, NULL);
+  usleep(duration * 1000);
+  stop = 1;
+  gettimeofday(&end, NULL);
+  for (i = 0; i < n; i++) {
+    pthread_join(threads[i], NULL);
+    commits += slots[i].commits;
+    aborts += slots[i].aborts;
+  }
+  pthread_barrier_destroy(&barrier);
+  free(threads);
+
+  printf("%-8d %14.0f %12lu\n", n,
+         commits / ((end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6), aborts);
+}
+
+int main(int argc, char **argv)
+{
+  const char *scheme;
+  int duration = DEFAULT_DURATION, max = DEFAULT_THREADS, n, check_only = 0;
+
+  if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+    /* Checks only */
+    check_only = 1;
+    argc--;
+    argv++;
+  }
+  if (argc > 1)
+    max = atoi(argv[1]);
+  if (argc > 2)
+    duration = atoi(argv[2]);
+  if (max < 1)
+    max = 1;
+
+  if ((slots = (slot_t *)aligned_alloc(CACHELINE, (max > CHECK_THREADS ? max : CHECK_THREADS) * sizeof(slot_t))) == NULL) {
+    perror("aligned_alloc");
+    exit(1);
+  }
+
+  stm_init();
+  if (stm_get_parameter("clock_scheme", &scheme))
+    printf("Clock scheme: %s\n", scheme);
+  check_exclusive();
+  check_monotonic();
+  printf("Commit timestamps OK\n");
+  if (check_only)
+    goto end;
+  printf("%-8s %14s %12s\n", "threads", "commits/s", "aborts");
+  for (n = 1; n <= max; n *= 2)
+    run(n, duration);
+ end:
+  stm_exit();
+  free(slots);
+
+  return 0;
+}
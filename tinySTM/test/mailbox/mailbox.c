@@ -0,0 +1,299 @@
+/*
+ * File:
+ *   mailbox.c
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   Rules applied by a worker to the verdicts of its supporters (stale
+ *   attempts, dooms, tag wraparound), and cost of polling the verdict
+ *   while the worker updates its hot fields, with the verdict on the same
+ *   cache line as these fields or on a line of its own (as the mailbox of
+ *   the descriptor).
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+#ifdef NDEBUG
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "stm.h"
+#include "verdict.h"
+
+#define CACHELINE                       64
+#define ITERATIONS                      (1 << 26)
+#define TX_ITERATIONS                   (1 << 16)
+#define TX_SIZE                         64
+
+#define TAGS                            ((stm_word_t)1 << VERDICT_TAG_BITS)
+#define STALE                           64  /* Older attempts checked */
+
+typedef struct shared {                 /* Old layout: everything together */
+  volatile stm_word_t end;              /* Written by the worker */
+  volatile stm_word_t nb_entries;       /* Written by the worker */
+  volatile stm_word_t status;           /* Written by the worker */
+  volatile stm_word_t verdict;          /* Written by the supporter */
+} shared_t;
+
+typedef struct isolated {               /* New layout: one writer per line */
+  volatile stm_word_t end;
+  volatile stm_word_t nb_entries;
+  volatile stm_word_t status;
+  char pad_before[CACHELINE];
+  volatile stm_word_t verdict;
+  char pad_after[CACHELINE];
+} isolated_t;
+
+static shared_t shared __attribute__((aligned(CACHELINE)));
+static isolated_t isolated __attribute__((aligned(CACHELINE)));
+static volatile stm_word_t data[TX_SIZE * 8];
+static volatile int stop;
+static int cpus[2] = { -1, -1 };
+
+/*
+ * Verdicts on other attempts must be ignored, whatever they say.
+ */
+static void check_stale(stm_word_t attempt)
+{
+  stm_word_t v, a;
+  int i;
+
+  for (i = 1; i <= STALE; i++) {
+    a = attempt - i;
+    v = VERDICT(a, VERDICT_COUNT_MAX, VERDICT_SPAN_MAX, 1);
+    assert(verdict_current(v, a) && verdict_dooms(v, a));
+    assert(!verdict_current(v, attempt) && !verdict_dooms(v, attempt));
+    v = VERDICT(a, 1, 1, 0);
+    assert(!verdict_current(v, attempt));
+  }
+}
+
+/*
+ * A doom aborts the attempt it was published for, and no other one.
+ */
+static void check_doom(stm_word_t attempt)
+{
+  stm_word_t v;
+
+  v = VERDICT(attempt, 0, 0, 1);
+  assert(verdict_dooms(v, attempt));
+  assert(!verdict_dooms(v, attempt + 1));
+  assert(!verdict_dooms(v, attempt - 1));
+  v = VERDICT(attempt, VERDICT_COUNT_MAX, VERDICT_SPAN_MAX, 0);
+  assert(verdict_current(v, attempt) && !verdict_dooms(v, attempt));
+  assert(VERDICT_COUNT(v) == VERDICT_COUNT_MAX && VERDICT_SPAN(v) == VERDICT_SPAN_MAX);
+}
+
+/*
+ * Replays the mailbox of a worker whose attempt start has been doomed
+ * while it starts the following attempts, across two tag wraparounds (as
+ * stm_prepare() does).  The doom must not apply to any of them, and
+ * neither may the verdict stored at a wraparound extend a snapshot.
+ */
+static void check_wraparound(stm_word_t start)
+{
+  stm_word_t mailbox, attempt, reset, i;
+  int resets = 0;
+
+  mailbox = VERDICT(start, 0, 0, 1);
+  for (i = 1; i <= 2 * TAGS + STALE; i++) {
+    attempt = start + i;
+    if ((reset = verdict_reset(attempt)) != 0) {
+      assert(VERDICT_FIELD(attempt, 0, VERDICT_TAG_BITS) == 0);
+      mailbox = reset;
+      resets++;
+    }
+    assert(!verdict_dooms(mailbox, attempt));
+    if (resets > 0 && verdict_current(mailbox, attempt))
+      assert(VERDICT_COUNT(mailbox) == 0 && VERDICT_SPAN(mailbox) == 0);
+  }
+  assert(resets >= 2);
+}
+
+static void check()
+{
+  stm_word_t attempts[] = {
+    1, 2, TAGS / 2,
+    TAGS - 2, TAGS - 1, TAGS, TAGS + 1,
+    3 * TAGS - 1, 3 * TAGS, (stm_word_t)-TAGS - 1, (stm_word_t)-2
+  };
+  int i;
+
+  assert(VERDICT(1, 0, 0, 0) != 0 && verdict_reset(1) == 0);
+  for (i = 0; i < sizeof(attempts) / sizeof(attempts[0]); i++) {
+    check_stale(attempts[i]);
+    check_doom(attempts[i]);
+    check_wraparound(attempts[i]);
+  }
+}
+
+static void bind(int cpu)
+{
+  cpu_set_t set;
+
+  if (cpu < 0)
+    return;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    perror("sched_setaffinity");
+}
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval end;
+
+  gettimeofday(&end, NULL);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_usec - start->tv_usec) * 1e3;
+}
+
+/*
+ * Supporter: keeps publishing verdicts (as when validating a long
+ * transaction repeatedly).
+ */
+static void *supporter(void *arg)
+{
+  volatile stm_word_t *verdict = (volatile stm_word_t *)arg;
+  stm_word_t v = 0;
+
+  bind(cpus[1]);
+  while (!stop) {
+    *verdict = (v += 2);
+    __asm volatile ("pause" ::: "memory");
+  }
+  return NULL;
+}
+
+/*
+ * Worker: updates its hot fields and polls the verdict, as stm_load()
+ * does.  Returns the time per iteration in nanoseconds.
+ */
+static double worker(volatile stm_word_t *end, volatile stm_word_t *nb_entries,
+                     volatile stm_word_t *status, volatile stm_word_t *verdict)
+{
+  struct timeval start;
+  pthread_t thread;
+  stm_word_t doomed = 0;
+  double t;
+  long i;
+
+  stop = 0;
+  if (pthread_create(&thread, NULL, supporter, (void *)verdict) != 0) {
+    perror("pthread_create");
+    exit(1);
+  }
+  gettimeofday(&start, NULL);
+  for (i = 0; i < ITERATIONS; i++) {
+    *status = i;
+    *nb_entries = i & 0xFF;
+    doomed += *verdict & 1;
+    *end = i;
+  }
+  t = elapsed(&start) / ITERATIONS;
+  stop = 1;
+  pthread_join(thread, NULL);
+  if (doomed != 0)
+    printf("unexpected verdict\n");
+
+  return t;
+}
+
+/*
+ * Same access pattern through the library: read-only transactions whose
+ * reads poll the mailbox while the supporter validates them.  Returns the
+ * time per load in nanoseconds.
+ */
+static void *bumper(void *arg)
+{
+  stm_word_t i;
+
+  bind(cpus[1]);
+  stm_init_thread();
+  for (i = 1; !stop; i++)
+    stm_unit_store((stm_word_t *)&data[(i % TX_SIZE) * 8], i, NULL);
+  stm_exit_thread();
+  return NULL;
+}
+
+static double library()
+{
+  struct timeval start;
+  pthread_t thread;
+  double t;
+  int n, i;
+
+  stop = 0;
+  if (pthread_create(&thread, NULL, bumper, NULL) != 0) {
+    perror("pthread_create");
+    exit(1);
+  }
+  gettimeofday(&start, NULL);
+  for (n = 0; n < TX_ITERATIONS; n++) {
+    stm_tx_attr_t attr = { 0, 0 };
+    sigjmp_buf *e = stm_start(&attr);
+    if (e != NULL)
+      sigsetjmp(*e, 0);
+    for (i = 0; i < TX_SIZE; i++)
+      stm_load(&data[i * 8]);
+    stm_commit();
+  }
+  t = elapsed(&start) / ((double)TX_ITERATIONS * TX_SIZE);
+  stop = 1;
+  pthread_join(thread, NULL);
+
+  return t;
+}
+
+int main(int argc, char **argv)
+{
+  double same, separate;
+  int n;
+
+  check();
+  printf("%-24s %12s\n", "verdicts", "OK");
+  if (argc > 1 && strcmp(argv[1], "-c") == 0)
+    return 0;
+
+  if (argc > 1)
+    cpus[0] = atoi(argv[1]);
+  if (argc > 2)
+    cpus[1] = atoi(argv[2]);
+  bind(cpus[0]);
+
+  same = worker(&shared.end, &shared.nb_entries, &shared.status, &shared.verdict);
+  separate = worker(&isolated.end, &isolated.nb_entries, &isolated.status, &isolated.verdict);
+  printf("%-24s %12s\n", "layout", "ns/iter");
+  printf("%-24s %12.3f\n", "verdict with hot fields", same);
+  printf("%-24s %12.3f\n", "verdict in mailbox", separate);
+
+  stm_init();
+  n = 2;
+  /* One group of supporters for the two threads */
+  if (!stm_set_parameter("supporter_ratio", &n))
+    printf("supporters not available\n");
+  stm_init_thread();
+  printf("%-24s %12.3f\n", "stm_load with supporter", library());
+  stm_exit_thread();
+  stm_exit();
+
+  return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * File:
+ *   preacquire.c
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   Regression test for commits with large write sets, whose locks are
+ *   acquired in parallel by the supporters with SUPPORTER_PREACQUIRE:
+ *   the words of each stripe are written from different chunks of the
+ *   write set, and concurrent readers check that no commit is torn.
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifdef NDEBUG
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stm.h"
+
+#define DEFAULT_DURATION                2000
+#define DEFAULT_NB_THREADS              4
+#define DEFAULT_SUPPORTER_RATIO         2
+
+#define NB_ELEMENTS                     256 /* Above SUPPORTER_PREACQUIRE_THRESHOLD */
+#define STRIDE                          17  /* Spreads the words of a stripe over the write set */
+
+#define XSTR(s)                         STR(s)
+#define STR(s)                          #s
+
+static volatile int stop;
+
+stm_word_t data[NB_ELEMENTS] __attribute__((aligned(64)));
+
+typedef struct thread_data {
+  int writer;
+  unsigned long nb_updates;
+  unsigned long nb_reads;
+  char padding[64];
+} thread_data_t;
+
+void *test(void *v)
+{
+  int i;
+  stm_word_t first;
+  sigjmp_buf *e;
+  thread_data_t *d = (thread_data_t *)v;
+
+  stm_init_thread();
+  while (stop == 0) {
+    e = stm_start(NULL);
+    if (e != NULL)
+      sigsetjmp(*e, 0);
+    if (d->writer) {
+      /* Increment all words, each stripe from several chunks */
+      first = stm_load(&data[0]);
+      for (i = 0; i < NB_ELEMENTS; i++)
+        stm_store(&data[(i * STRIDE) % NB_ELEMENTS], first + 1);
+    } else {
+      /* All words must have been written by the same commit */
+      first = stm_load(&data[0]);
+      for (i = 1; i < NB_ELEMENTS; i++) {
+        if (stm_load(&data[i]) != first) {
+          fprintf(stderr, "ERROR: torn commit at word %d\n", i);
+          exit(1);
+        }
+      }
+    }
+    stm_commit();
+    if (d->writer)
+      d->nb_updates++;
+    else
+      d->nb_reads++;
+  }
+  stm_exit_thread();
+
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  struct option long_options[] = {
+    // These options don't set a flag
+    {"help",                      no_argument,       NULL, 'h'},
+    {"duration",                  required_argument, NULL, 'd'},
+    {"num-threads",               required_argument, NULL, 'n'},
+    {"supporter-ratio",           required_argument, NULL, 's'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int i, c;
+  unsigned long updates, reads;
+  thread_data_t *td;
+  pthread_t *threads;
+  pthread_attr_t attr;
+  struct timespec timeout;
+  int duration = DEFAULT_DURATION;
+  int nb_threads = DEFAULT_NB_THREADS;
+  int supporter_ratio = DEFAULT_SUPPORTER_RATIO;
+
+  while(1) {
+    i = 0;
+    c = getopt_long(argc, argv, "hd:n:s:", long_options, &i);
+
+    if(c == -1)
+      break;
+
+    if(c == 0 && long_options[i].flag == 0)
+      c = long_options[i].val;
+
+    switch(c) {
+     case 0:
+       /* Flag is automatically set */
+       break;
+     case 'h':
+       printf("preacquire -- STM stress test "
+              "\n"
+              "Usage:\n"
+              "  preacquire [options...]\n"
+              "\n"
+              "Options:\n"
+              "  -h, --help\n"
+              "        Print this message\n"
+              "  -d, --duration <int>\n"
+              "        Test duration in milliseconds (default=" XSTR(DEFAULT_DURATION) ")\n"
+              "  -n, --num-threads <int>\n"
+              "        Number of threads, half of them writers (default=" XSTR(DEFAULT_NB_THREADS) ")\n"
+              "  -s, --supporter-ratio <int>\n"
+              "        Workers per supporter group (default=" XSTR(DEFAULT_SUPPORTER_RATIO) ")\n"
+         );
+       exit(0);
+     case 'd':
+       duration = atoi(optarg);
+       break;
+     case 'n':
+       nb_threads = atoi(optarg);
+       break;
+     case 's':
+       supporter_ratio = atoi(optarg);
+       break;
+     case '?':
+       printf("Use -h or --help for help\n");
+       exit(0);
+     default:
+       exit(1);
+    }
+  }
+
+  assert(duration > 0);
+  assert(nb_threads > 1);
+  assert(supporter_ratio >= 0);
+
+  printf("Duration     : %d\n", duration);
+  printf("Nb threads   : %d\n", nb_threads);
+  printf("Group size   : %d workers\n", supporter_ratio);
+
+  for (i = 0; i < NB_ELEMENTS; i++)
+    data[i] = 0;
+
+  /* Init STM */
+  printf("Initializing STM\n");
+  stm_init();
+  if (stm_set_parameter("supporter_ratio", &supporter_ratio) == 0)
+    printf("WARNING: cannot set supporter ratio\n");
+
+  timeout.tv_sec = duration / 1000;
+  timeout.tv_nsec = (duration % 1000) * 1000000;
+
+  if ((td = (thread_data_t *)calloc(nb_threads, sizeof(thread_data_t))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  if ((threads = (pthread_t *)malloc(nb_threads * sizeof(pthread_t))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+  stop = 0;
+  for (i = 0; i < nb_threads; i++) {
+    td[i].writer = (i % 2 == 0);
+    if (pthread_create(&threads[i], &attr, test, (void *)(&td[i])) != 0) {
+      fprintf(stderr, "Error creating thread\n");
+      exit(1);
+    }
+  }
+  pthread_attr_destroy(&attr);
+  nanosleep(&timeout, NULL);
+  stop = 1;
+  for (i = 0; i < nb_threads; i++) {
+    if (pthread_join(threads[i], NULL) != 0) {
+      fprintf(stderr, "Error waiting for thread completion\n");
+      exit(1);
+    }
+  }
+
+  updates = reads = 0;
+  for (i = 0; i < nb_threads; i++) {
+    updates += td[i].nb_updates;
+    reads += td[i].nb_reads;
+  }
+  printf("Updates      : %lu\n", updates);
+  printf("Reads        : %lu\n", reads);
+
+  /* Each commit incremented all words */
+  for (i = 0; i < NB_ELEMENTS; i++)
+    assert(data[i] == updates);
+
+  /* Cleanup STM */
+  stm_exit();
+
+  free(td);
+  free(threads);
+
+  return 0;
+}
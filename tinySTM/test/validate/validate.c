@@ -0,0 +1,184 @@
+/*
+ * File:
+ *   validate.c
+ * Author(s):
+ *   agent <agent@local>
+ * Description:
+ *   Verdicts and throughput of read set validation per read set size and
+ *   kernel.
+ *
+ * Copyright (c) 2026.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifdef NDEBUG
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "stm.h"
+
+#define START(id, ro)                   { stm_tx_attr_t _a = {id, ro}; sigjmp_buf *_e = stm_start(&_a); if (_e != NULL) sigsetjmp(*_e, 0)
+#define LOAD(addr)                      stm_load((stm_word_t *)addr)
+#define STORE(addr, value)              stm_store((stm_word_t *)addr, (stm_word_t)value)
+#define COMMIT                          stm_commit(); }
+
+#define MAX_SIZE                        (1 << 16)
+#define EXTENSIONS                      32
+#define STRIDE                          8                   /* Words between two bump locations (distinct locks) */
+#define ENTRIES_PER_RUN                 (1 << 25)
+#define CHECK_SIZE                      35                  /* Several blocks of 4 and 8 entries plus a tail */
+#define OWNED_EVERY                     3                   /* Entries also written in the owned lock cases */
+
+static volatile stm_word_t data[MAX_SIZE];
+/* Far enough from data not to share its locks */
+static volatile stm_word_t bump[EXTENSIONS * STRIDE];
+
+/*
+ * Read size words, possibly write one in OWNED_EVERY of them (so that the
+ * transaction owns their locks, except with commit-time locking), update
+ * the word at position fail (if any) with a unit store, then read a word
+ * updated after the start so that the snapshot must be extended.  Returns
+ * whether validating the read set failed (the transaction restarted).
+ */
+static int check_one(int size, int owned, int fail)
+{
+  static volatile int attempts;
+  int i;
+
+  attempts = 0;
+  START(0, 0);
+  if (++attempts == 1) {
+    for (i = 0; i < size; i++)
+      LOAD(&data[i * STRIDE]);
+    if (owned) {
+      for (i = 0; i < size; i += OWNED_EVERY) {
+        if (i != fail)
+          STORE(&data[i * STRIDE], 0);
+      }
+    }
+    if (fail >= 0)
+      stm_unit_store((stm_word_t *)&data[fail * STRIDE], 0, NULL);
+    stm_unit_store((stm_word_t *)&bump[0], 0, NULL);
+    LOAD(&bump[0]);
+  }
+  COMMIT;
+
+  return attempts > 1;
+}
+
+/*
+ * Whatever the kernel, validation must fail when any entry is stale: at
+ * every position of a block of 4 or 8 entries, in the tail of the read
+ * set, and among locks owned by the transaction (which the kernels leave
+ * to the scalar check).  It must succeed otherwise.
+ */
+static void check(const char *kernel)
+{
+  int size, owned, fail;
+
+  for (size = 1; size <= CHECK_SIZE; size++) {
+    for (owned = 0; owned <= 1; owned++) {
+      assert(check_one(size, owned, -1) == 0);
+      for (fail = 0; fail < size; fail++) {
+        if (check_one(size, owned, fail) != 1) {
+          fprintf(stderr, "ERROR: %s kernel validated a stale entry (size %d, position %d%s)\n",
+                  kernel, size, fail, (owned ? ", owned locks" : ""));
+          exit(1);
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Read size words, then read EXTENSIONS other words.  If validate is set,
+ * each of these words is first updated by a unit store, so that reading
+ * it extends the snapshot and validates the whole read set.
+ */
+static double run(int size, int validate)
+{
+  struct timeval start, end;
+  int i, n, iterations;
+
+  iterations = ENTRIES_PER_RUN / (size * EXTENSIONS);
+  if (iterations == 0)
+    iterations = 1;
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    START(0, 0);
+    for (i = 0; i < size; i++)
+      LOAD(&data[i]);
+    for (i = 0; i < EXTENSIONS; i++) {
+      if (validate)
+        stm_unit_store((stm_word_t *)&bump[i * STRIDE], n, NULL);
+      LOAD(&bump[i * STRIDE]);
+    }
+    COMMIT;
+  }
+  gettimeofday(&end, NULL);
+
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_usec - start.tv_usec) * 1e3)
+    / ((double)iterations * size * EXTENSIONS);
+}
+
+int main(int argc, char **argv)
+{
+  const char *kernels[] = { "scalar", "avx2", "avx512" };
+  double with, without;
+  int k, size, check_only;
+
+  /* -c: only check the verdicts of the kernels */
+  check_only = (argc > 1 && strcmp(argv[1], "-c") == 0);
+
+  stm_init();
+  stm_init_thread();
+
+  for (k = 0; k < 3; k++) {
+    if (!stm_set_parameter("validation_kernel", (void *)kernels[k])) {
+      printf("%-8s (not supported)\n", kernels[k]);
+      continue;
+    }
+    check(kernels[k]);
+    printf("%-8s verdicts OK\n", kernels[k]);
+  }
+  if (check_only)
+    goto end;
+
+  printf("%-8s %8s %12s %12s\n", "kernel", "size", "ns/entry", "Mentries/s");
+  for (k = 0; k < 3; k++) {
+    if (!stm_set_parameter("validation_kernel", (void *)kernels[k]))
+      continue;
+    for (size = 16; size <= MAX_SIZE; size *= 4) {
+      /* Warm up (read set allocation) */
+      run(size, 1);
+      without = run(size, 0);
+      with = run(size, 1);
+      if (with < without)
+        with = without;
+      printf("%-8s %8d %12.3f %12.1f\n", kernels[k], size, with - without,
+             (with > without ? 1e3 / (with - without) : 0.0));
+    }
+  }
+
+
+ end:
+  stm_exit_thread();
+  stm_exit();
+
+  return 0;
+}